@@ -4,6 +4,7 @@
 #include <drogon/drogon.h>
 #include <drogon/orm/Exception.h>
 #include <sw/redis++/redis++.h>
+#include <algorithm>
 #include <random>
 #include <iomanip>
 #include <sstream>
@@ -113,6 +114,22 @@ void ApiController::createTenant(const HttpRequestPtr& req, function<void(const
     string name = (*json)["name"].asString();
     string firebaseUid = (*json).get("firebase_uid", "").asString();
     int memoryMb = (*json).get("memory_limit_mb", 40).asInt();
+    string policy = (*json).get("maxmemory_policy", "allkeys-lru").asString();
+    transform(policy.begin(), policy.end(), policy.begin(), ::tolower);
+
+    // Checked here, before any row exists, so a typo is a 400 rather than a
+    // tenant that /node/start refuses. Keep in sync with parseEvictionPolicy
+    // in node/NodeManager.cpp.
+    static const set<string> kPolicies = {"noeviction", "allkeys-lru", "allkeys-lfu",
+                                          "volatile-lru", "volatile-ttl"};
+    if (kPolicies.count(policy) == 0) {
+        Json::Value error;
+        error["error"] = "unknown maxmemory_policy: " + policy;
+        auto resp = HttpResponse::newHttpJsonResponse(error);
+        resp->setStatusCode(k400BadRequest);
+        callback(resp);
+        return;
+    }
 
     // Auto-assign available port
     int nodePort = findAvailablePort();
@@ -129,13 +146,17 @@ void ApiController::createTenant(const HttpRequestPtr& req, function<void(const
  
     cout << "[Backend]   Port: " << nodePort << " (auto-assigned)" << endl;
     cout << "[Backend]   Memory: " << memoryMb << "MB" << endl;
+    cout << "[Backend]   Policy: " << policy << endl;
+
+    // Nodes run inside the node manager; routers reach them on this host
+    string nodeHost = EnvLoader::get("NODE_HOST", "node-manager");
 
     // Let PostgreSQL generate UUID using uuid_generate_v4()
-    auto sql = "INSERT INTO tenants (id, name, node_port, firebase_uid, memory_limit_mb) "
-               "VALUES (uuid_generate_v4(), $1, $2, $3, $4) RETURNING id::text";
+    auto sql = "INSERT INTO tenants (id, name, node_port, firebase_uid, memory_limit_mb, node_host, maxmemory_policy) "
+               "VALUES (uuid_generate_v4(), $1, $2, $3, $4, $5, $6) RETURNING id::text";
     
     db_->execSqlAsync(sql,
-        [callback, nodePort, memoryMb, name](const drogon::orm::Result &result) {
+        [this, callback, nodePort, memoryMb, policy, name](const drogon::orm::Result &result) {
             
             string tenantId = result[0][0].as<string>();
             
@@ -147,12 +168,13 @@ void ApiController::createTenant(const HttpRequestPtr& req, function<void(const
             nodeJson["tenant_id"] = tenantId;
             nodeJson["port"] = nodePort;
             nodeJson["memory_limit_mb"] = memoryMb;
+            nodeJson["maxmemory_policy"] = policy;
             
             auto nodeReq = HttpRequest::newHttpJsonRequest(nodeJson);
             nodeReq->setMethod(Post);
             nodeReq->setPath("/node/start");
 
-            nodeClient->sendRequest(nodeReq, [callback, tenantId, nodePort](ReqResult result, const HttpResponsePtr& nodeResp) {
+            nodeClient->sendRequest(nodeReq, [this, callback, tenantId, nodePort](ReqResult result, const HttpResponsePtr& nodeResp) {
                 if (result == ReqResult::Ok && nodeResp->getStatusCode() == k200OK) {
                     cout << "[Backend]  Node started successfully" << endl;
                     
@@ -170,6 +192,14 @@ void ApiController::createTenant(const HttpRequestPtr& req, function<void(const
                     } else {
                         cout << " Node Manager returned status: "<< endl;
                     }
+
+                    // No node is serving this tenant; take it out of /api/routes
+                    db_->execSqlAsync("UPDATE tenants SET status = 'failed' WHERE id = $1",
+                        [](const drogon::orm::Result &) {},
+                        [](const drogon::orm::DrogonDbException &e) {
+                            cout << "[Backend]  Failed to mark tenant failed: " << e.base().what() << endl;
+                        },
+                        tenantId);
                     
                     Json::Value response;
                     response["error"] = "Failed to start node";
@@ -192,12 +222,12 @@ void ApiController::createTenant(const HttpRequestPtr& req, function<void(const
             resp->setStatusCode(k500InternalServerError);
             callback(resp);
         },
-        name, nodePort, firebaseUid, memoryMb);
+        name, nodePort, firebaseUid, memoryMb, nodeHost, policy);
 }
 
 void ApiController::getTenant(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback, const string &tenantId)
 {
-    auto sql = "SELECT id, name, node_port, firebase_uid, status FROM tenants WHERE id = $1";
+    auto sql = "SELECT id, name, node_host, node_port, firebase_uid, status, maxmemory_policy FROM tenants WHERE id = $1";
     db_->execSqlAsync(sql,
         [callback](const drogon::orm::Result &r) {
             if (r.size() == 0) {
@@ -212,9 +242,11 @@ void ApiController::getTenant(const HttpRequestPtr &req, function<void(const Htt
             Json::Value out;
             out["tenant_id"] = r[0]["id"].as<string>();
             out["name"] = r[0]["name"].as<string>();
+            out["node_host"] = r[0]["node_host"].as<string>();
             out["node_port"] = r[0]["node_port"].as<int>();
             out["firebase_uid"] = r[0]["firebase_uid"].as<string>();
             out["status"] = r[0]["status"].as<string>();
+            out["maxmemory_policy"] = r[0]["maxmemory_policy"].as<string>();
             callback(HttpResponse::newHttpJsonResponse(out));
         },
         [callback](const drogon::orm::DrogonDbException &e) {
@@ -264,6 +296,58 @@ void ApiController::getUserTenants(const HttpRequestPtr &req,
         firebaseUid);
 }
 
+// Tenant placement for the routers. since=0 returns every tenant; otherwise
+// only tenants written by transaction since or later, including ones no
+// longer active so routers can drop them. cursor in the response is the
+// oldest transaction still in flight when the query ran: everything older has
+// committed (or aborted) and was visible to it, while a slow UPDATE that
+// commits after this poll still has a txid >= cursor and shows up in the
+// next one. Rows can repeat across polls; each carries the tenant's current
+// route, so routers apply them idempotently.
+void ApiController::getRoutes(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback)
+{
+    long long since = strtoll(req->getParameter("since").c_str(), nullptr, 10);
+    if (since < 0) since = 0;
+
+    // The LEFT JOIN keeps one row (with a NULL tenant) when nothing changed,
+    // so the horizon still comes back from the same snapshot
+    auto sql = "WITH h AS (SELECT txid_snapshot_xmin(txid_current_snapshot())::bigint AS horizon) "
+               "SELECT h.horizon, t.id::text AS tenant_id, t.node_host, t.node_port, "
+               "COALESCE(t.status, 'active') AS status "
+               "FROM h LEFT JOIN tenants t ON t.route_txid >= $1 "
+               "ORDER BY t.route_txid";
+    db_->execSqlAsync(sql,
+        [callback, since](const drogon::orm::Result &r) {
+            Json::Value routes(Json::arrayValue);
+            // Taken as is, not max'ed with since, so a cursor from an older
+            // scheme (e.g. updated_at microseconds) cannot pin a router
+            long long cursor = r.size() > 0 ? r[0]["horizon"].as<long long>() : since;
+            for (size_t i = 0; i < r.size(); ++i) {
+                if (r[i]["tenant_id"].isNull()) continue;
+
+                Json::Value route;
+                route["tenant_id"] = r[i]["tenant_id"].as<string>();
+                route["node_host"] = r[i]["node_host"].as<string>();
+                route["node_port"] = r[i]["node_port"].as<int>();
+                route["status"] = r[i]["status"].as<string>();
+                routes.append(route);
+            }
+
+            Json::Value out;
+            out["cursor"] = Json::Int64(cursor);
+            out["routes"] = routes;
+            callback(HttpResponse::newHttpJsonResponse(out));
+        },
+        [callback](const drogon::orm::DrogonDbException &e) {
+            Json::Value error;
+            error["error"] = "database error";
+            auto resp = HttpResponse::newHttpJsonResponse(error);
+            resp->setStatusCode(k500InternalServerError);
+            callback(resp);
+        },
+        since);
+}
+
 void ApiController::createApiKey(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback)
 {
     auto json = req->getJsonObject();
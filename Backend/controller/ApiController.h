@@ -17,6 +17,7 @@ public:
     ADD_METHOD_TO(ApiController::createTenant, "/api/tenants", Post);
     ADD_METHOD_TO(ApiController::getTenant, "/api/tenants/{1}", Get);
     ADD_METHOD_TO(ApiController::getUserTenants, "/api/user/{1}/tenants", Get);
+    ADD_METHOD_TO(ApiController::getRoutes, "/api/routes", Get);
     
     // API Key management
     ADD_METHOD_TO(ApiController::createApiKey, "/api/apikeys", Post);
@@ -33,6 +34,7 @@ public:
     void createTenant(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback);
     void getTenant(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback, const string &tenantId);
     void getUserTenants(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback, const string &firebaseUid);
+    void getRoutes(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback);
     
     // API Key methods
     void createApiKey(const HttpRequestPtr &req, function<void(const HttpResponsePtr &)> &&callback);
@@ -19,15 +19,33 @@ CREATE TABLE tenants (
   id UUID PRIMARY KEY DEFAULT uuid_generate_v4(),
   name TEXT NOT NULL,
   firebase_uid VARCHAR(128) NOT NULL, 
+  node_host TEXT NOT NULL DEFAULT 'node-manager',
   node_port INT NOT NULL UNIQUE,
   memory_limit_mb INT NOT NULL DEFAULT 40,
+  maxmemory_policy TEXT NOT NULL DEFAULT 'allkeys-lru',
   status VARCHAR(50) DEFAULT 'active',
   created_at TIMESTAMP WITH TIME ZONE DEFAULT now(),
-  updated_at TIMESTAMP WITH TIME ZONE DEFAULT now()
+  updated_at TIMESTAMP WITH TIME ZONE DEFAULT now(),
+  route_txid BIGINT NOT NULL DEFAULT txid_current()
 );
 
 CREATE INDEX idx_tenants_firebase_uid ON tenants(firebase_uid);
 CREATE INDEX idx_tenants_status ON tenants(status);
+CREATE INDEX idx_tenants_route_txid ON tenants(route_txid);
+
+-- Routers poll tenants by route_txid (the last writing transaction), so every
+-- change to a row must bump it
+CREATE FUNCTION tenants_touch_updated_at() RETURNS trigger AS $$
+BEGIN
+  NEW.updated_at = now();
+  NEW.route_txid = txid_current();
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER tenants_touch_updated_at
+  BEFORE UPDATE ON tenants
+  FOR EACH ROW EXECUTE FUNCTION tenants_touch_updated_at();
 
 
 CREATE TABLE api_keys (
@@ -97,6 +115,7 @@ SELECT
   t.id as tenant_id,
   t.name as tenant_name,
   t.firebase_uid,
+  t.node_host,
   t.node_port,
   t.memory_limit_mb,
   t.status,
@@ -0,0 +1,14 @@
+ALTER TABLE tenants ADD COLUMN IF NOT EXISTS node_host TEXT NOT NULL DEFAULT 'node-manager';
+
+
+CREATE OR REPLACE FUNCTION tenants_touch_updated_at() RETURNS trigger AS $$
+BEGIN
+  NEW.updated_at = now();
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+DROP TRIGGER IF EXISTS tenants_touch_updated_at ON tenants;
+CREATE TRIGGER tenants_touch_updated_at
+  BEFORE UPDATE ON tenants
+  FOR EACH ROW EXECUTE FUNCTION tenants_touch_updated_at();
@@ -0,0 +1 @@
+ALTER TABLE tenants ADD COLUMN IF NOT EXISTS maxmemory_policy TEXT NOT NULL DEFAULT 'allkeys-lru';
@@ -0,0 +1,15 @@
+-- Commit-ordered cursor for GET /api/routes. updated_at = now() is the
+-- writing transaction's start time, so a row that commits late can carry a
+-- timestamp older than a cursor a router has already moved past. Routers
+-- instead page by the id of the transaction that last wrote the row and
+-- resume from the oldest transaction still in flight.
+ALTER TABLE tenants ADD COLUMN IF NOT EXISTS route_txid BIGINT NOT NULL DEFAULT txid_current();
+CREATE INDEX IF NOT EXISTS idx_tenants_route_txid ON tenants(route_txid);
+
+CREATE OR REPLACE FUNCTION tenants_touch_updated_at() RETURNS trigger AS $$
+BEGIN
+  NEW.updated_at = now();
+  NEW.route_txid = txid_current();
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
@@ -0,0 +1,203 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include "../common/RespParser.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// Small helpers shared by the load generators: option parsing, connecting,
+// RESP and HTTP encoding and reply counting. Linux only, like the servers they drive.
+namespace bench {
+
+// Value of "--name value" on the command line, or fallback
+inline std::string option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+inline bool flag(int argc, char** argv, const char* name) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+// "100,1000,10000" -> {100, 1000, 10000}
+inline std::vector<long> parseList(const std::string& text) {
+    std::vector<long> out;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == std::string::npos) comma = text.size();
+        out.push_back(std::atol(text.substr(pos, comma - pos).c_str()));
+        pos = comma + 1;
+    }
+    return out;
+}
+
+// Lets one process hold 10k+ client sockets
+inline void raiseFdLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Blocking TCP connection with Nagle off; -1 on failure
+inline int connectTcp(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+inline void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+inline bool sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+// One RESP multibulk command
+inline std::string command(std::initializer_list<std::string_view> args) {
+    std::string out = "*" + std::to_string(args.size()) + "\r\n";
+    for (std::string_view arg : args) {
+        out += "$" + std::to_string(arg.size()) + "\r\n";
+        out.append(arg.data(), arg.size());
+        out += "\r\n";
+    }
+    return out;
+}
+
+// Counts complete replies in a byte stream that may split them anywhere
+class ReplyCounter {
+public:
+    // Returns how many replies the bytes completed
+    size_t feed(const char* data, size_t len) {
+        buffer_.append(data, len);
+        size_t pos = 0, replies = 0;
+        while (pos < buffer_.size()) {
+            size_t consumed = 0;
+            if (RespParser::scanReply(buffer_.data() + pos, buffer_.size() - pos, consumed) != RespParser::Ok) break;
+            if (buffer_[pos] == '-') errors_++;
+            pos += consumed;
+            replies++;
+        }
+        buffer_.erase(0, pos);
+        return replies;
+    }
+
+    size_t errors() const { return errors_; }
+
+private:
+    std::string buffer_;
+    size_t errors_ = 0;
+};
+
+// Reads until `count` replies have arrived on a blocking socket
+inline bool awaitReplies(int fd, ReplyCounter& counter, size_t count) {
+    char buf[1 << 16];
+    while (count > 0) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        size_t got = counter.feed(buf, static_cast<size_t>(n));
+        count -= std::min(got, count);
+    }
+    return true;
+}
+
+// HTTP/1.1 keep-alive request; extraHeaders are full "Name: value\r\n" lines
+inline std::string httpRequest(const char* method, const std::string& path, const std::string& body,
+                               const std::string& extraHeaders = "") {
+    std::string out = std::string(method) + " " + path + " HTTP/1.1\r\nHost: bench\r\n";
+    if (!body.empty()) out += "Content-Type: application/json\r\n";
+    out += "Content-Length: " + std::to_string(body.size()) + "\r\n" + extraHeaders + "\r\n";
+    return out + body;
+}
+
+// Reads one Content-Length framed response from a blocking socket. buffer
+// carries bytes of the next response over between calls.
+inline bool readHttpResponse(int fd, std::string& buffer, int& status, std::string* body = nullptr) {
+    char buf[1 << 16];
+    for (;;) {
+        size_t end = buffer.find("\r\n\r\n");
+        if (end != std::string::npos) {
+            size_t length = 0;
+            std::string head = buffer.substr(0, end);
+            std::transform(head.begin(), head.end(), head.begin(), ::tolower);
+            size_t field = head.find("\r\ncontent-length:");
+            if (field != std::string::npos) length = std::strtoul(head.c_str() + field + 17, nullptr, 10);
+            if (buffer.size() >= end + 4 + length) {
+                status = std::atoi(buffer.c_str() + buffer.find(' ') + 1);
+                if (body) body->assign(buffer, end + 4, length);
+                buffer.erase(0, end + 4 + length);
+                return true;
+            }
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        buffer.append(buf, static_cast<size_t>(n));
+    }
+}
+
+// p in [0, 1]; sorts samples
+inline double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    size_t i = static_cast<size_t>(p * static_cast<double>(samples.size() - 1));
+    return samples[i];
+}
+
+// Resident set size of a process in bytes, from /proc
+inline long rssBytes(int pid) {
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE* f = std::fopen(path, "r");
+    if (!f) return -1;
+    char line[256];
+    long kb = -1;
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, "VmRSS:", 6) == 0) kb = std::atol(line + 6);
+    }
+    std::fclose(f);
+    return kb * 1024;
+}
+
+} // namespace bench
+
+#endif
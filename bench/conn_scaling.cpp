@@ -0,0 +1,82 @@
+// Connection scaling for the storage node (src/main.cpp).
+//
+// For each client count, opens that many connections and keeps exactly one
+// GET in flight on each (ping-pong), driven by one epoll loop, and reports
+// completed requests per second. Thread-per-connection servers fall off as
+// the count grows; reactors should stay flat.
+//
+//   ./storage_node --port 6379 &
+//   ./conn_scaling --port 6379 --clients 100,1000,10000 --seconds 5
+#include "BenchUtil.h"
+#include <sys/epoll.h>
+#include <chrono>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static double run(const std::string& host, int port, long clients, double seconds) {
+    int ep = epoll_create1(0);
+    std::vector<int> fds;
+    std::vector<bench::ReplyCounter> counters(static_cast<size_t>(clients));
+    for (long i = 0; i < clients; ++i) {
+        int fd = bench::connectTcp(host, port);
+        if (fd < 0) {
+            std::fprintf(stderr, "connect failed after %ld clients: %s\n", i, std::strerror(errno));
+            break;
+        }
+        bench::setNonBlocking(fd);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = fds.size();
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+    }
+
+    const std::string request = bench::command({"GET", "bench:key"});
+    for (int fd : fds) bench::sendAll(fd, request);
+
+    // Warm up for a tenth of the run, then count
+    long completed = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point measureFrom = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds / 10));
+    Clock::time_point end = measureFrom + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+    epoll_event events[1024];
+    char buf[1 << 14];
+    while (Clock::now() < end) {
+        int n = epoll_wait(ep, events, 1024, 100);
+        bool counting = Clock::now() >= measureFrom;
+        for (int i = 0; i < n; ++i) {
+            size_t c = events[i].data.u64;
+            ssize_t got = recv(fds[c], buf, sizeof(buf), 0);
+            if (got <= 0) continue;
+            size_t replies = counters[c].feed(buf, static_cast<size_t>(got));
+            for (size_t r = 0; r < replies; ++r) {
+                if (counting) completed++;
+                bench::sendAll(fds[c], request);
+            }
+        }
+    }
+
+    for (int fd : fds) close(fd);
+    close(ep);
+    return static_cast<double>(completed) / seconds;
+}
+
+int main(int argc, char** argv) {
+    std::string host = bench::option(argc, argv, "--host", "127.0.0.1");
+    int port = std::atoi(bench::option(argc, argv, "--port", "6379").c_str());
+    std::vector<long> clientCounts = bench::parseList(bench::option(argc, argv, "--clients", "100,1000,10000"));
+    double seconds = std::atof(bench::option(argc, argv, "--seconds", "5").c_str());
+
+    bench::raiseFdLimit();
+    std::printf("%10s %12s\n", "clients", "ops/s");
+    for (long clients : clientCounts) {
+        double rate = run(host, port, clients, seconds);
+        std::printf("%10ld %12.0f\n", clients, rate);
+        // Let the server reap the closed connections before the next round
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Storage node memory per key and SET throughput.
+//
+// Loads --keys keys over one connection with --pipeline SETs in flight, using
+// 10-byte keys and 10-byte values (and EX --ex when given), then reports
+// SET/s and how much the node's resident set grew per key. --pid is the
+// storage node's process id, read from /proc, so run both on one machine:
+//
+//   ./storage_node --port 6379 & echo $! > node.pid
+//   ./entry_footprint --port 6379 --pid $(cat node.pid) --keys 500000
+//   ./entry_footprint --port 6379 --pid $(cat node.pid) --keys 500000 --ex 3600
+//
+// Use a fresh node for each run; keys from an earlier run are overwritten in
+// place and would not grow the resident set. The node's tenant is capped at
+// 40 MB of charged memory, so past roughly 800k keys the rest of the SETs are
+// refused; bytes/key is taken over the keys actually stored.
+#include "BenchUtil.h"
+#include <chrono>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    std::string host = bench::option(argc, argv, "--host", "127.0.0.1");
+    int port = std::atoi(bench::option(argc, argv, "--port", "6379").c_str());
+    int pid = std::atoi(bench::option(argc, argv, "--pid", "0").c_str());
+    long keys = std::atol(bench::option(argc, argv, "--keys", "500000").c_str());
+    long pipeline = std::atol(bench::option(argc, argv, "--pipeline", "1000").c_str());
+    std::string ex = bench::option(argc, argv, "--ex", "");
+
+    long before = bench::rssBytes(pid);
+    if (pid <= 0 || before < 0) {
+        std::fprintf(stderr, "--pid must be the storage node's process id\n");
+        return 1;
+    }
+    int fd = bench::connectTcp(host, port);
+    if (fd < 0) {
+        std::fprintf(stderr, "cannot connect to %s:%d\n", host.c_str(), port);
+        return 1;
+    }
+
+    bench::ReplyCounter counter;
+    Clock::time_point start = Clock::now();
+    for (long i = 0; i < keys; i += pipeline) {
+        std::string out;
+        long n = std::min(pipeline, keys - i);
+        char key[16], value[16];
+        for (long k = i; k < i + n; ++k) {
+            std::snprintf(key, sizeof(key), "k:%08ld", k);
+            std::snprintf(value, sizeof(value), "v:%08ld", k);
+            out += ex.empty() ? bench::command({"SET", key, value}) : bench::command({"SET", key, value, "EX", ex});
+        }
+        if (!bench::sendAll(fd, out) || !bench::awaitReplies(fd, counter, static_cast<size_t>(n))) {
+            std::fprintf(stderr, "connection lost after %ld keys\n", i);
+            return 1;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    close(fd);
+
+    // Let the node finish any deferred work before sampling
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    long after = bench::rssBytes(pid);
+
+    long stored = keys - static_cast<long>(counter.errors());
+    std::printf("%10s %10s %12s %12s %10s\n", "keys", "stored", "sets/s", "rss_delta_mb", "bytes/key");
+    std::printf("%10ld %10ld %12.0f %12ld %10.1f\n", keys, stored, static_cast<double>(keys) / elapsed,
+                (after - before) >> 20, static_cast<double>(after - before) / static_cast<double>(std::max(stored, 1L)));
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Cache hit ratio of each maxmemory policy under a Zipfian workload.
+//
+// Replays --ops requests over --keys keys whose popularity follows a Zipf
+// distribution with exponent --skew against a tenant of --memory-mb. Each
+// request is a GET; a miss is followed by a SET of the key (with a one hour
+// TTL so the volatile policies have candidates), as a read-through cache
+// would do. Prints the hit ratio, resident keys and evictions per policy.
+//
+//   ./eviction_hit_ratio --keys 200000 --ops 2000000 --skew 0.99 --memory-mb 4
+#include "BenchUtil.h"
+#include "NodeManager.h"
+#include <cmath>
+#include <random>
+
+int main(int argc, char** argv) {
+    long keys = std::atol(bench::option(argc, argv, "--keys", "200000").c_str());
+    long ops = std::atol(bench::option(argc, argv, "--ops", "2000000").c_str());
+    double skew = std::atof(bench::option(argc, argv, "--skew", "0.99").c_str());
+    int memoryMb = std::atoi(bench::option(argc, argv, "--memory-mb", "4").c_str());
+    std::string policies = bench::option(argc, argv, "--policies",
+                                         "allkeys-lru,allkeys-lfu,volatile-lru,volatile-ttl,noeviction");
+    const long long ttlMs = 3600 * 1000;
+
+    // Inverse-CDF sampling; rank 0 is the hottest key
+    std::vector<double> cdf(static_cast<size_t>(keys));
+    double sum = 0;
+    for (long i = 0; i < keys; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+        cdf[static_cast<size_t>(i)] = sum;
+    }
+    for (double& c : cdf) c /= sum;
+
+    std::printf("%-14s %10s %10s %10s\n", "policy", "hit_ratio", "keys", "evicted");
+    size_t start = 0;
+    while (start < policies.size()) {
+        size_t comma = policies.find(',', start);
+        if (comma == std::string::npos) comma = policies.size();
+        std::string name = policies.substr(start, comma - start);
+        start = comma + 1;
+
+        EvictionPolicy policy;
+        if (!parseEvictionPolicy(name, policy)) {
+            std::fprintf(stderr, "unknown policy %s\n", name.c_str());
+            return 1;
+        }
+        RedisNode node("bench", 0, memoryMb, policy);
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<double> uniform(0, 1);
+        long hits = 0;
+        for (long i = 0; i < ops; ++i) {
+            size_t rank = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin());
+            std::string key = "key:" + std::to_string(rank);
+            if (node.get(key)[1] != '-') {
+                hits++;
+            } else {
+                node.set(key, "value", ttlMs);
+            }
+        }
+        std::printf("%-14s %10.3f %10zu %10zu\n", name.c_str(), static_cast<double>(hits) / static_cast<double>(ops),
+                    node.getKeyCount(), node.getEvictedKeys());
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// /node/execute versus /node/execute_batch throughput.
+//
+// Sends --commands SETs to one tenant, first one per POST /node/execute, then
+// --batch at a time per POST /node/execute_batch (once plain, once atomic),
+// all on a single keep-alive connection to the node manager. The tenant is
+// created with /node/start first; that is a no-op if it already exists.
+//
+//   ./execute_batch --port 7000 --commands 100000 --batch 100
+//
+// With --in-process the same comparison runs against NodeManager directly,
+// which leaves out HTTP and JSON and isolates the per-command lookup cost.
+#include "BenchUtil.h"
+#include "NodeManager.h"
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+static std::string setCommand(long i) {
+    return "SET key:" + std::to_string(i) + " value";
+}
+
+static double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static int runInProcess(long commands, long batchSize) {
+    NodeManager manager;
+    manager.startNode("bench", 0, 1024);
+    std::vector<std::string> all;
+    for (long i = 0; i < commands; ++i) all.push_back(setCommand(i));
+
+    Clock::time_point start = Clock::now();
+    for (const auto& command : all) manager.executeCommand("bench", command);
+    double single = seconds(start);
+
+    double batched[2];
+    for (int atomic = 0; atomic < 2; ++atomic) {
+        start = Clock::now();
+        for (long i = 0; i < commands; i += batchSize) {
+            std::vector<std::string> batch(all.begin() + i, all.begin() + std::min(commands, i + batchSize));
+            manager.executeBatch("bench", batch, atomic == 1);
+        }
+        batched[atomic] = seconds(start);
+    }
+
+    std::printf("%-16s %12s\n", "endpoint", "commands/s");
+    std::printf("%-16s %12.0f\n", "execute", static_cast<double>(commands) / single);
+    std::printf("%-16s %12.0f\n", "batch", static_cast<double>(commands) / batched[0]);
+    std::printf("%-16s %12.0f\n", "batch atomic", static_cast<double>(commands) / batched[1]);
+    manager.stopAllNodes();
+    return 0;
+}
+
+// Sends one request and waits for a 200
+static bool post(int fd, std::string& buffer, const std::string& path, const std::string& body) {
+    int status = 0;
+    return bench::sendAll(fd, bench::httpRequest("POST", path, body)) &&
+           bench::readHttpResponse(fd, buffer, status) && status == 200;
+}
+
+int main(int argc, char** argv) {
+    std::string host = bench::option(argc, argv, "--host", "127.0.0.1");
+    int port = std::atoi(bench::option(argc, argv, "--port", "7000").c_str());
+    std::string tenant = bench::option(argc, argv, "--tenant", "bench");
+    std::string nodePort = bench::option(argc, argv, "--node-port", "6399");
+    long commands = std::atol(bench::option(argc, argv, "--commands", "100000").c_str());
+    long batchSize = std::atol(bench::option(argc, argv, "--batch", "100").c_str());
+
+    if (bench::flag(argc, argv, "--in-process")) return runInProcess(commands, batchSize);
+
+    int fd = bench::connectTcp(host, port);
+    std::string buffer;
+    if (fd < 0 || !post(fd, buffer, "/node/start",
+                        "{\"tenant_id\":\"" + tenant + "\",\"port\":" + nodePort + ",\"memory_limit_mb\":1024}")) {
+        std::fprintf(stderr, "cannot start tenant %s via %s:%d\n", tenant.c_str(), host.c_str(), port);
+        return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    for (long i = 0; i < commands; ++i) {
+        if (!post(fd, buffer, "/node/execute",
+                  "{\"tenant_id\":\"" + tenant + "\",\"command\":\"" + setCommand(i) + "\"}")) {
+            std::fprintf(stderr, "/node/execute failed\n");
+            return 1;
+        }
+    }
+    double single = seconds(start);
+
+    double batched[2];
+    for (int atomic = 0; atomic < 2; ++atomic) {
+        start = Clock::now();
+        for (long i = 0; i < commands; i += batchSize) {
+            std::string body = "{\"tenant_id\":\"" + tenant + "\",\"atomic\":" + (atomic ? "true" : "false") +
+                               ",\"commands\":[";
+            for (long k = i; k < std::min(commands, i + batchSize); ++k) {
+                if (k > i) body += ",";
+                body += "\"" + setCommand(k) + "\"";
+            }
+            body += "]}";
+            if (!post(fd, buffer, "/node/execute_batch", body)) {
+                std::fprintf(stderr, "/node/execute_batch failed\n");
+                return 1;
+            }
+        }
+        batched[atomic] = seconds(start);
+    }
+    close(fd);
+
+    std::printf("%-16s %12s %12s\n", "endpoint", "commands/s", "requests/s");
+    double requests = static_cast<double>((commands + batchSize - 1) / batchSize);
+    std::printf("%-16s %12.0f %12.0f\n", "execute", static_cast<double>(commands) / single,
+                static_cast<double>(commands) / single);
+    std::printf("%-16s %12.0f %12.0f\n", "batch", static_cast<double>(commands) / batched[0],
+                requests / batched[0]);
+    std::printf("%-16s %12.0f %12.0f\n", "batch atomic", static_cast<double>(commands) / batched[1],
+                requests / batched[1]);
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Storage node throughput with shard locks versus shard owners.
+//
+// Runs three phases against one node and prints ops/s for each:
+//   bulk      one connection loads --keys keys with 1000 SETs in flight
+//   pingpong  --clients connections, one GET or SET in flight on each
+//   pipeline  the same connections with --pipeline commands in flight
+// GETs and SETs (--set-ratio) pick keys uniformly, so they land on every
+// shard and, with --shard-owners, on every owner. Run it once per mode and
+// worker count, pinning the node to the cores under test:
+//
+//   taskset -c 0-7 ./storage_node --port 6379 --workers 8 &
+//   taskset -c 0-7 ./storage_node --port 6379 --workers 8 --shard-owners &
+//   taskset -c 8-15 ./owner_vs_mutex --port 6379 --clients 64
+#include "BenchUtil.h"
+#include <sys/epoll.h>
+#include <chrono>
+#include <random>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host;
+    int port;
+    long keys;
+    long clients;
+    int pipeline;
+    double setRatio;
+    double seconds;
+};
+
+static std::string keyName(long i) {
+    return "key:" + std::to_string(i);
+}
+
+static double bulkLoad(const Options& opt, size_t& errors) {
+    int fd = bench::connectTcp(opt.host, opt.port);
+    if (fd < 0) return -1;
+    bench::ReplyCounter counter;
+    const long batch = 1000;
+    Clock::time_point start = Clock::now();
+    for (long i = 0; i < opt.keys; i += batch) {
+        std::string out;
+        long n = std::min(batch, opt.keys - i);
+        for (long k = i; k < i + n; ++k) out += bench::command({"SET", keyName(k), "value"});
+        if (!bench::sendAll(fd, out) || !bench::awaitReplies(fd, counter, static_cast<size_t>(n))) {
+            close(fd);
+            return -1;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    close(fd);
+    errors = counter.errors();
+    return static_cast<double>(opt.keys) / elapsed;
+}
+
+// Every connection keeps `depth` commands in flight; one epoll loop drives them all
+static double closedLoop(const Options& opt, int depth, size_t& errors) {
+    int ep = epoll_create1(0);
+    std::vector<int> fds;
+    std::vector<bench::ReplyCounter> counters(static_cast<size_t>(opt.clients));
+    std::vector<int> outstanding(static_cast<size_t>(opt.clients), 0);
+    for (long i = 0; i < opt.clients; ++i) {
+        int fd = bench::connectTcp(opt.host, opt.port);
+        if (fd < 0) break;
+        bench::setNonBlocking(fd);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = fds.size();
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+    }
+
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<long> pick(0, opt.keys - 1);
+    std::uniform_real_distribution<double> coin(0, 1);
+    auto sendBatch = [&](size_t c) {
+        std::string out;
+        for (int i = 0; i < depth; ++i) {
+            std::string key = keyName(pick(rng));
+            out += coin(rng) < opt.setRatio ? bench::command({"SET", key, "value"}) : bench::command({"GET", key});
+        }
+        outstanding[c] = depth;
+        bench::sendAll(fds[c], out);
+    };
+    for (size_t c = 0; c < fds.size(); ++c) sendBatch(c);
+
+    // Warm up for a tenth of the run, then count
+    long completed = 0;
+    Clock::time_point measureFrom = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(opt.seconds / 10));
+    Clock::time_point end = measureFrom + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(opt.seconds));
+    epoll_event events[1024];
+    char buf[1 << 16];
+    while (Clock::now() < end) {
+        int n = epoll_wait(ep, events, 1024, 100);
+        bool counting = Clock::now() >= measureFrom;
+        for (int i = 0; i < n; ++i) {
+            size_t c = events[i].data.u64;
+            ssize_t got = recv(fds[c], buf, sizeof(buf), 0);
+            if (got <= 0) continue;
+            size_t replies = counters[c].feed(buf, static_cast<size_t>(got));
+            if (counting) completed += static_cast<long>(replies);
+            outstanding[c] -= static_cast<int>(replies);
+            if (outstanding[c] <= 0) sendBatch(c);
+        }
+    }
+
+    errors = 0;
+    for (size_t c = 0; c < fds.size(); ++c) {
+        errors += counters[c].errors();
+        close(fds[c]);
+    }
+    close(ep);
+    return static_cast<double>(completed) / opt.seconds;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    opt.host = bench::option(argc, argv, "--host", "127.0.0.1");
+    opt.port = std::atoi(bench::option(argc, argv, "--port", "6379").c_str());
+    opt.keys = std::atol(bench::option(argc, argv, "--keys", "200000").c_str());
+    opt.clients = std::atol(bench::option(argc, argv, "--clients", "64").c_str());
+    opt.pipeline = std::atoi(bench::option(argc, argv, "--pipeline", "16").c_str());
+    opt.setRatio = std::atof(bench::option(argc, argv, "--set-ratio", "0.1").c_str());
+    opt.seconds = std::atof(bench::option(argc, argv, "--seconds", "5").c_str());
+
+    bench::raiseFdLimit();
+    size_t errors = 0;
+    double bulk = bulkLoad(opt, errors);
+    if (bulk < 0) {
+        std::fprintf(stderr, "cannot load keys into %s:%d\n", opt.host.c_str(), opt.port);
+        return 1;
+    }
+    std::printf("%-10s %12s %8s\n", "phase", "ops/s", "errors");
+    std::printf("%-10s %12.0f %8zu\n", "bulk", bulk, errors);
+    double pingPong = closedLoop(opt, 1, errors);
+    std::printf("%-10s %12.0f %8zu\n", "pingpong", pingPong, errors);
+    double pipelined = closedLoop(opt, opt.pipeline, errors);
+    std::printf("%-10s %12.0f %8zu\n", "pipeline", pipelined, errors);
+    return 0;
+}
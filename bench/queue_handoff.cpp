@@ -0,0 +1,203 @@
+// Cost of handing a request batch from a reactor to a worker.
+//
+// Compares the storage node's MpmcQueue against the mutex + condition
+// variable + std::queue it replaced, with an item shaped like a
+// ClientRequest (connection pointer, payload buffer, command list).
+//
+// First, one thread pushes and pops --items items in bursts of 64, which is
+// the uncontended cost per hand-off. Then, for each --threads entry PxC, P
+// producers push --items items in total to C consumers and the time per item
+// is reported, with rejected pushes (queue full) counted as busy as the node
+// would answer them. The contended numbers need at least P + C cores.
+//
+//   ./queue_handoff --items 5000000 --threads 1x1,2x2,4x4,8x8
+#include "BenchUtil.h"
+#include "../common/MpmcQueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t QUEUE_CAPACITY = 1024;
+
+struct Request {
+    std::shared_ptr<int> conn;
+    std::vector<char> payload;
+    std::vector<int> commands;
+};
+
+static double nsPer(Clock::time_point start, long items) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(items);
+}
+
+static void singleThread(long items) {
+    const long burst = 64;
+    auto conn = std::make_shared<int>(1);
+
+    std::queue<Request> locked;
+    std::mutex mutex;
+    std::condition_variable ready;
+    Clock::time_point start = Clock::now();
+    for (long i = 0; i < items; i += burst) {
+        for (long j = 0; j < burst; ++j) {
+            Request request;
+            request.conn = conn;
+            std::unique_lock<std::mutex> lock(mutex);
+            if (locked.size() < QUEUE_CAPACITY) {
+                locked.push(std::move(request));
+                lock.unlock();
+                ready.notify_one();
+            }
+        }
+        for (long j = 0; j < burst; ++j) {
+            std::lock_guard<std::mutex> lock(mutex);
+            Request request = std::move(locked.front());
+            locked.pop();
+        }
+    }
+    std::printf("%-34s %8.1f ns\n", "mutex + condvar + queue<Request>", nsPer(start, items));
+
+    MpmcQueue<Request*> ring(QUEUE_CAPACITY);
+    start = Clock::now();
+    for (long i = 0; i < items; i += burst) {
+        for (long j = 0; j < burst; ++j) {
+            Request* request = new Request;
+            request->conn = conn;
+            if (!ring.push(request)) delete request;
+        }
+        for (long j = 0; j < burst; ++j) {
+            Request* request = nullptr;
+            if (ring.tryPop(request)) delete request;
+        }
+    }
+    std::printf("%-34s %8.1f ns\n", "MpmcQueue<Request*> + new/delete", nsPer(start, items));
+
+    Request shared;
+    start = Clock::now();
+    for (long i = 0; i < items; i += burst) {
+        for (long j = 0; j < burst; ++j) ring.push(&shared);
+        for (long j = 0; j < burst; ++j) {
+            Request* request = nullptr;
+            ring.tryPop(request);
+        }
+    }
+    std::printf("%-34s %8.1f ns\n", "MpmcQueue ring only", nsPer(start, items));
+}
+
+// P producers, C consumers; returns ns per item and the busy count
+static double contended(bool useRing, int producers, int consumers, long items, long& busy) {
+    auto conn = std::make_shared<int>(1);
+    std::queue<Request> locked;
+    std::mutex mutex;
+    std::condition_variable ready;
+    MpmcQueue<Request*> ring(QUEUE_CAPACITY);
+    std::atomic<bool> stop{false};
+    std::atomic<long> consumed{0}, rejected{0};
+    long perProducer = items / producers;
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            if (useRing) {
+                MpmcQueue<Request*>::Consumer self;
+                Request* request = nullptr;
+                while (ring.pop(request, self, stop)) {
+                    delete request;
+                    consumed++;
+                }
+                return;
+            }
+            for (;;) {
+                Request request;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&] { return !locked.empty() || stop.load(); });
+                    if (locked.empty()) return;
+                    request = std::move(locked.front());
+                    locked.pop();
+                }
+                consumed++;
+            }
+        });
+    }
+    std::vector<std::thread> producerThreads;
+    for (int p = 0; p < producers; ++p) {
+        producerThreads.emplace_back([&] {
+            for (long i = 0; i < perProducer; ++i) {
+                Request request;
+                request.conn = conn;
+                request.payload.resize(32);
+                request.commands.resize(1);
+                if (useRing) {
+                    Request* item = new Request(std::move(request));
+                    if (!ring.push(item)) {
+                        delete item;
+                        rejected++;
+                        std::this_thread::yield();
+                    }
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                if (locked.size() < QUEUE_CAPACITY) {
+                    locked.push(std::move(request));
+                    lock.unlock();
+                    ready.notify_one();
+                } else {
+                    lock.unlock();
+                    rejected++;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : producerThreads) t.join();
+    while (consumed.load() + rejected.load() < perProducer * producers) std::this_thread::yield();
+    double ns = nsPer(start, perProducer * producers);
+
+    stop = true;
+    if (useRing) {
+        ring.wakeAll();
+    } else {
+        { std::lock_guard<std::mutex> lock(mutex); }
+        ready.notify_all();
+    }
+    for (auto& t : threads) t.join();
+    busy = rejected.load();
+    return ns;
+}
+
+int main(int argc, char** argv) {
+    long items = std::atol(bench::option(argc, argv, "--items", "5000000").c_str());
+    std::string threads = bench::option(argc, argv, "--threads", "1x1,2x2,4x4,8x8");
+
+    std::printf("single thread, per push + pop:\n");
+    singleThread(items);
+
+    std::printf("\n%8s %12s %10s %12s %10s\n", "PxC", "mutex_ns", "busy", "mpmc_ns", "busy");
+    size_t pos = 0;
+    while (pos < threads.size()) {
+        size_t comma = threads.find(',', pos);
+        if (comma == std::string::npos) comma = threads.size();
+        std::string pair = threads.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        int producers = std::atoi(pair.c_str());
+        size_t x = pair.find('x');
+        int consumers = x == std::string::npos ? producers : std::atoi(pair.c_str() + x + 1);
+        if (producers <= 0 || consumers <= 0) {
+            std::fprintf(stderr, "bad --threads entry %s\n", pair.c_str());
+            return 1;
+        }
+        long mutexBusy = 0, ringBusy = 0;
+        double mutexNs = contended(false, producers, consumers, items, mutexBusy);
+        double ringNs = contended(true, producers, consumers, items, ringBusy);
+        std::printf("%8s %12.1f %10ld %12.1f %10ld\n", pair.c_str(), mutexNs, mutexBusy, ringNs, ringBusy);
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Worst-case insert latency while a keyspace grows through its resizes.
+//
+// Inserts --keys distinct keys one at a time and times each insert, then
+// prints the average, p99.9, p99.99, the number of inserts over 1 ms and the
+// five slowest inserts with the key count at which they happened. A pause
+// that scales with the table shows up as a slow insert at a power-of-two
+// boundary.
+//
+//   ./rehash_latency --mode node --keys 10000000     RedisNode::set
+//   ./rehash_latency --mode table --budget-us 100     bare SwissTable
+//   ./rehash_latency --mode umap                      std::unordered_map
+//   ./rehash_latency --mode idle --seconds 6          stalls of the machine itself
+//
+// node mode takes its rehash budget from NODE_REHASH_BUDGET_US like the node
+// manager does. idle mode times an empty loop, for how much of the worst case
+// is the scheduler rather than the table.
+#include "BenchUtil.h"
+#include "NodeManager.h"
+#include "../common/SwissTable.h"
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+// Slots point at keys stored elsewhere, as the storage node's entries do
+struct KeyOfPointer {
+    std::string_view operator()(const std::string* key) const { return *key; }
+};
+
+static void report(const char* mode, std::vector<float>& latencyUs, double seconds) {
+    size_t n = latencyUs.size();
+    std::vector<std::pair<float, size_t>> slowest;
+    size_t overMs = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (latencyUs[i] > 1000) overMs++;
+        slowest.emplace_back(latencyUs[i], i);
+    }
+    size_t top = std::min<size_t>(5, n);
+    std::partial_sort(slowest.begin(), slowest.begin() + static_cast<long>(top), slowest.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::vector<double> sorted(latencyUs.begin(), latencyUs.end());
+    double p999 = bench::percentile(sorted, 0.999);
+    double p9999 = bench::percentile(sorted, 0.9999);
+    std::printf("%s: %zu inserts in %.2fs, avg %.3f us, p99.9 %.1f us, p99.99 %.1f us, %zu over 1 ms\n", mode, n,
+                seconds, seconds * 1e6 / static_cast<double>(n), p999, p9999, overMs);
+    std::printf("slowest (us@keys):");
+    for (size_t i = 0; i < top; ++i) std::printf(" %.0f@%zu", slowest[i].first, slowest[i].second);
+    std::printf("\n");
+}
+
+// Times insert(i) for every i in [0, keys)
+static void timeInserts(const char* mode, long keys, const std::function<void(long)>& insert) {
+    std::vector<float> latencyUs(static_cast<size_t>(keys));
+    Clock::time_point start = Clock::now();
+    for (long i = 0; i < keys; ++i) {
+        Clock::time_point before = Clock::now();
+        insert(i);
+        latencyUs[static_cast<size_t>(i)] = std::chrono::duration<float, std::micro>(Clock::now() - before).count();
+    }
+    report(mode, latencyUs, std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+int main(int argc, char** argv) {
+    std::string mode = bench::option(argc, argv, "--mode", "node");
+    long keys = std::atol(bench::option(argc, argv, "--keys", "10000000").c_str());
+    long budgetUs = std::atol(bench::option(argc, argv, "--budget-us", "100").c_str());
+    double seconds = std::atof(bench::option(argc, argv, "--seconds", "6").c_str());
+
+    if (mode == "idle") {
+        // Only the stalls are kept, so recording does not cause any
+        std::vector<std::pair<float, double>> stalls;   // (us, seconds in)
+        Clock::time_point start = Clock::now(), last = start;
+        while (std::chrono::duration<double>(last - start).count() < seconds) {
+            Clock::time_point now = Clock::now();
+            float gapUs = std::chrono::duration<float, std::micro>(now - last).count();
+            if (gapUs > 1000) stalls.emplace_back(gapUs, std::chrono::duration<double>(now - start).count());
+            last = now;
+        }
+        std::sort(stalls.begin(), stalls.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        std::printf("idle: %zu stalls over 1 ms in %.0fs\nslowest (us@s):", stalls.size(), seconds);
+        for (size_t i = 0; i < std::min<size_t>(5, stalls.size()); ++i) {
+            std::printf(" %.0f@%.2f", stalls[i].first, stalls[i].second);
+        }
+        std::printf("\n");
+        return 0;
+    }
+
+    std::vector<std::string> names(static_cast<size_t>(keys));
+    char buf[32];
+    for (long i = 0; i < keys; ++i) {
+        std::snprintf(buf, sizeof(buf), "key:%010ld", i);
+        names[static_cast<size_t>(i)] = buf;
+    }
+
+    if (mode == "node") {
+        RedisNode node("bench", 0, 2000, EvictionPolicy::NoEviction);
+        std::string value = "v";
+        long refused = 0;
+        timeInserts("node", keys, [&](long i) {
+            if (node.set(names[static_cast<size_t>(i)], value)[0] == '-') refused++;
+        });
+        if (refused > 0) std::fprintf(stderr, "%ld SETs refused; lower --keys\n", refused);
+    } else if (mode == "table") {
+        SwissTable<const std::string*, KeyOfPointer> table;
+        table.setRehashBudget(std::chrono::microseconds(budgetUs));
+        timeInserts("table", keys, [&](long i) {
+            const std::string* key = &names[static_cast<size_t>(i)];
+            size_t hash = table.hashOf(*key);
+            if (!table.find(*key, hash)) table.insert(std::move(key), hash);
+        });
+    } else if (mode == "umap") {
+        std::unordered_map<std::string_view, const std::string*> map;
+        timeInserts("umap", keys, [&](long i) {
+            const std::string& key = names[static_cast<size_t>(i)];
+            map.emplace(key, &key);
+        });
+    } else {
+        std::fprintf(stderr, "unknown --mode %s (node, table, umap or idle)\n", mode.c_str());
+        return 1;
+    }
+    return 0;
+}
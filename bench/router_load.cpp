@@ -0,0 +1,171 @@
+// HTTP router latency while the backend API is slow.
+//
+// Runs a stand-in backend on --backend-port that answers /api/verify and
+// /api/routes after --delays milliseconds, pointing every key at one tenant
+// whose node listens on --node-port. --clients connections then POST GETs to
+// the router's /redis with a key it has already verified, while
+// --slow-clients connections send a fresh key each time, so every one of
+// their requests waits on the backend. Prints p50/p99 of the warm clients per
+// delay; on a non-blocking router they stay flat as the delay grows.
+//
+//   ./storage_node --port 6399 &
+//   DB_HOST=127.0.0.1 BACKEND_PORT=5599 ROUTER_PORT=6300 ./router &
+//   ./router_load --router-port 6300 --backend-port 5599 --node-port 6399 --delays 0,50,500
+//
+// The router refuses to start without ../../../.env, and entries there win
+// over the environment, so keep DB_HOST/BACKEND_PORT out of that file. It
+// may start before router_load: its first route poll fails, and the first
+// request for the tenant triggers another one.
+#include "BenchUtil.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<long> backendDelayMs{0};
+
+static void serveBackendConnection(int fd, int nodePort) {
+    std::string buffer;
+    char buf[4096];
+    for (;;) {
+        size_t end;
+        while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                close(fd);
+                return;
+            }
+            buffer.append(buf, static_cast<size_t>(n));
+        }
+        std::string requestLine = buffer.substr(0, buffer.find("\r\n"));
+        buffer.erase(0, end + 4);   // GETs only, so no body
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(backendDelayMs.load()));
+        std::string body;
+        if (requestLine.find(" /api/verify") != std::string::npos) {
+            body = "{\"tenant_id\":\"bench\"}";
+        } else if (requestLine.find(" /api/routes") != std::string::npos) {
+            body = "{\"cursor\":1,\"routes\":[{\"tenant_id\":\"bench\",\"node_host\":\"127.0.0.1\","
+                   "\"node_port\":" + std::to_string(nodePort) + ",\"status\":\"active\"}]}";
+        }
+        std::string response = body.empty() ? "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n"
+                                             : "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                               "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        if (!bench::sendAll(fd, response)) {
+            close(fd);
+            return;
+        }
+    }
+}
+
+static bool startBackend(int port, int nodePort) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listener, 128) != 0) {
+        close(listener);
+        return false;
+    }
+    std::thread([listener, nodePort] {
+        for (;;) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) continue;
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            std::thread(serveBackendConnection, fd, nodePort).detach();
+        }
+    }).detach();
+    return true;
+}
+
+struct Phase {
+    std::atomic<bool> counting{false}, stop{false};
+    std::atomic<long> slowRequests{0}, failures{0};
+    std::vector<std::vector<double>> latencies;   // per warm client, in ms
+};
+
+// One keep-alive connection issuing requests back to back
+static void client(const std::string& host, int port, Phase& phase, int index, bool slow) {
+    int fd = bench::connectTcp(host, port);
+    if (fd < 0) {
+        phase.failures++;
+        return;
+    }
+    std::string buffer, request = bench::command({"GET", "key"});
+    long sequence = 0;
+    while (!phase.stop.load(std::memory_order_relaxed)) {
+        std::string key = slow ? "slow-" + std::to_string(index) + "-" + std::to_string(sequence++) : "warm";
+        Clock::time_point start = Clock::now();
+        int status = 0;
+        if (!bench::sendAll(fd, bench::httpRequest("POST", "/redis", request, "X-API-Key: " + key + "\r\n")) ||
+            !bench::readHttpResponse(fd, buffer, status)) {
+            phase.failures++;
+            break;
+        }
+        if (status != 200) phase.failures++;
+        if (!phase.counting.load(std::memory_order_relaxed)) continue;
+        if (slow) {
+            phase.slowRequests++;
+        } else {
+            phase.latencies[static_cast<size_t>(index)].push_back(
+                std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    std::string host = bench::option(argc, argv, "--host", "127.0.0.1");
+    int routerPort = std::atoi(bench::option(argc, argv, "--router-port", "6300").c_str());
+    int backendPort = std::atoi(bench::option(argc, argv, "--backend-port", "5599").c_str());
+    int nodePort = std::atoi(bench::option(argc, argv, "--node-port", "6399").c_str());
+    int clients = std::atoi(bench::option(argc, argv, "--clients", "32").c_str());
+    int slowClients = std::atoi(bench::option(argc, argv, "--slow-clients", "32").c_str());
+    double seconds = std::atof(bench::option(argc, argv, "--seconds", "10").c_str());
+    std::vector<long> delays = bench::parseList(bench::option(argc, argv, "--delays", "0,50,500"));
+
+    bench::raiseFdLimit();
+    if (!startBackend(backendPort, nodePort)) {
+        std::fprintf(stderr, "cannot listen on backend port %d\n", backendPort);
+        return 1;
+    }
+
+    std::printf("%10s %10s %10s %10s %12s %10s\n", "delay_ms", "requests", "p50_ms", "p99_ms", "slow_req/s",
+                "failures");
+    for (long delay : delays) {
+        backendDelayMs = delay;
+        Phase phase;
+        phase.latencies.resize(static_cast<size_t>(clients));
+        std::vector<std::thread> threads;
+        for (int i = 0; i < clients; ++i) {
+            threads.emplace_back(client, host, routerPort, std::ref(phase), i, false);
+        }
+        for (int i = 0; i < slowClients; ++i) {
+            threads.emplace_back(client, host, routerPort, std::ref(phase), i, true);
+        }
+
+        // The warm-up also lets the router verify "warm" and learn the route
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds / 10 + static_cast<double>(delay) / 500));
+        phase.counting = true;
+        Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        phase.counting = false;
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        phase.stop = true;
+        for (auto& t : threads) t.join();
+
+        std::vector<double> all;
+        for (const auto& samples : phase.latencies) all.insert(all.end(), samples.begin(), samples.end());
+        size_t requests = all.size();
+        double p50 = bench::percentile(all, 0.50);
+        double p99 = bench::percentile(all, 0.99);
+        std::printf("%10ld %10zu %10.2f %10.2f %12.0f %10ld\n", delay, requests, p50, p99,
+                    static_cast<double>(phase.slowRequests.load()) / elapsed, phase.failures.load());
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+// RedisNode::set cost as the keyspace grows.
+//
+// Inserts --keys distinct keys into one tenant and prints the average and
+// worst SET latency for every --interval keys, so a write cost that grows
+// with the key count (e.g. rescanning storage_ for memory accounting) shows
+// up as a rising average.
+//
+//   ./set_latency --keys 1000000 --interval 100000
+#include "BenchUtil.h"
+#include "NodeManager.h"
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    long keys = std::atol(bench::option(argc, argv, "--keys", "1000000").c_str());
+    long interval = std::atol(bench::option(argc, argv, "--interval", "100000").c_str());
+    int memoryMb = std::atoi(bench::option(argc, argv, "--memory-mb", "1024").c_str());
+
+    RedisNode node("bench", 0, memoryMb, EvictionPolicy::NoEviction);
+    std::printf("%10s %12s %12s %14s\n", "keys", "avg_us", "max_us", "memory_bytes");
+    double total = 0, worst = 0;
+    for (long i = 0; i < keys; ++i) {
+        std::string key = "key:" + std::to_string(i);
+        std::string value = "value-" + std::to_string(i);
+        Clock::time_point start = Clock::now();
+        std::string reply = node.set(key, value);
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        if (reply[0] == '-') {
+            std::fprintf(stderr, "SET failed at %ld keys: %s", i, reply.c_str());
+            return 1;
+        }
+        total += us;
+        worst = std::max(worst, us);
+        if ((i + 1) % interval == 0) {
+            std::printf("%10ld %12.3f %12.1f %14zu\n", i + 1, total / static_cast<double>(interval), worst,
+                        node.getMemoryUsage());
+            total = 0;
+            worst = 0;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+// GET/SET scaling of the storage node's sharded keyspace.
+//
+// Preloads --keys keys, then for each thread count runs that many client
+// threads, each on its own connection with --pipeline commands in flight,
+// issuing GETs and (with probability --set-ratio) SETs over uniformly chosen
+// keys. Reports ops/s per thread count. Give the node as many workers as the
+// largest thread count and pin it to the cores under test, e.g.:
+//
+//   taskset -c 0-31 ./storage_node --port 6379 --workers 32 &
+//   taskset -c 32-63 ./store_scaling --port 6379 --threads 1,2,4,8,16,32
+#include "BenchUtil.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host;
+    int port;
+    long keys;
+    int pipeline;
+    double setRatio;
+    double seconds;
+};
+
+static std::string keyName(long i) {
+    return "key:" + std::to_string(i);
+}
+
+static bool preload(const Options& opt) {
+    int fd = bench::connectTcp(opt.host, opt.port);
+    if (fd < 0) return false;
+    bench::ReplyCounter counter;
+    const long batch = 1000;
+    for (long i = 0; i < opt.keys; i += batch) {
+        std::string out;
+        long n = std::min(batch, opt.keys - i);
+        for (long k = i; k < i + n; ++k) out += bench::command({"SET", keyName(k), "value"});
+        if (!bench::sendAll(fd, out) || !bench::awaitReplies(fd, counter, static_cast<size_t>(n))) {
+            close(fd);
+            return false;
+        }
+    }
+    close(fd);
+    return true;
+}
+
+static double run(const Options& opt, int threads, long& errors) {
+    std::atomic<bool> counting{false}, stop{false};
+    std::atomic<long> completed{0}, errorReplies{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            int fd = bench::connectTcp(opt.host, opt.port);
+            if (fd < 0) return;
+            std::mt19937_64 rng(static_cast<uint64_t>(t) + 1);
+            std::uniform_int_distribution<long> pick(0, opt.keys - 1);
+            std::uniform_real_distribution<double> coin(0, 1);
+            bench::ReplyCounter counter;
+            long done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                std::string out;
+                for (int i = 0; i < opt.pipeline; ++i) {
+                    std::string key = keyName(pick(rng));
+                    out += coin(rng) < opt.setRatio ? bench::command({"SET", key, "value"})
+                                                    : bench::command({"GET", key});
+                }
+                if (!bench::sendAll(fd, out) || !bench::awaitReplies(fd, counter, static_cast<size_t>(opt.pipeline))) break;
+                if (counting.load(std::memory_order_relaxed)) done += opt.pipeline;
+            }
+            completed += done;
+            errorReplies += static_cast<long>(counter.errors());
+            close(fd);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.seconds / 10));
+    counting = true;
+    Clock::time_point start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.seconds));
+    counting = false;
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    stop = true;
+    for (auto& w : workers) w.join();
+    errors = errorReplies;
+    return static_cast<double>(completed.load()) / elapsed;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    opt.host = bench::option(argc, argv, "--host", "127.0.0.1");
+    opt.port = std::atoi(bench::option(argc, argv, "--port", "6379").c_str());
+    opt.keys = std::atol(bench::option(argc, argv, "--keys", "100000").c_str());
+    opt.pipeline = std::atoi(bench::option(argc, argv, "--pipeline", "16").c_str());
+    opt.setRatio = std::atof(bench::option(argc, argv, "--set-ratio", "0.1").c_str());
+    opt.seconds = std::atof(bench::option(argc, argv, "--seconds", "5").c_str());
+    std::vector<long> threadCounts = bench::parseList(bench::option(argc, argv, "--threads", "1,2,4,8,16,32"));
+
+    if (!preload(opt)) {
+        std::fprintf(stderr, "cannot preload %s:%d\n", opt.host.c_str(), opt.port);
+        return 1;
+    }
+
+    std::printf("%8s %12s %10s %8s\n", "threads", "ops/s", "speedup", "errors");
+    double base = 0;
+    for (long threads : threadCounts) {
+        long errors = 0;
+        double rate = run(opt, static_cast<int>(threads), errors);
+        if (base == 0) base = rate;
+        std::printf("%8ld %12.0f %9.2fx %8ld\n", threads, rate, rate / base, errors);
+    }
+    return 0;
+}
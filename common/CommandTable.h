@@ -0,0 +1,285 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Every command a MiniRedis server knows, indexed by CommandId. Servers keep
+// their own handler array indexed the same way and leave a command they do not
+// implement without a handler.
+enum CommandId : uint8_t {
+    CMD_SET,
+    CMD_GET,
+    CMD_DEL,
+    CMD_EXISTS,
+    CMD_INCR,
+    CMD_DECR,
+    CMD_INCRBY,
+    CMD_DECRBY,
+    CMD_KEYS,
+    CMD_SCAN,
+    CMD_FLUSHALL,
+    CMD_PING,
+    CMD_QUIT,
+    CMD_INFO,
+    CMD_COMMAND,
+    CMD_TYPE,
+    CMD_HSET,
+    CMD_HGET,
+    CMD_HDEL,
+    CMD_HGETALL,
+    CMD_HLEN,
+    CMD_HEXISTS,
+    CMD_HINCRBY,
+    CMD_LPUSH,
+    CMD_RPUSH,
+    CMD_LPOP,
+    CMD_RPOP,
+    CMD_LLEN,
+    CMD_LRANGE,
+    CMD_LINDEX,
+    CMD_SADD,
+    CMD_SREM,
+    CMD_SISMEMBER,
+    CMD_SMEMBERS,
+    CMD_SCARD,
+    CMD_ZADD,
+    CMD_ZREM,
+    CMD_ZSCORE,
+    CMD_ZCARD,
+    CMD_ZRANK,
+    CMD_ZRANGE,
+    CMD_ZRANGEBYSCORE,
+    CMD_COUNT
+};
+
+enum CommandFlags : uint8_t {
+    CMD_WRITE = 1,     // may modify the keyspace
+    CMD_READONLY = 2,  // only reads keys
+    CMD_FAST = 4       // O(1) or O(log n); never scans the keyspace
+};
+
+// What COMMAND INFO reports: the name (lower case), the arity in Redis terms
+// (N means exactly N arguments counting the name, -N at least N) and where the
+// keys are in argv (0 for a command without keys, lastKey -1 for "to the end").
+struct CommandSpec {
+    const char* name;
+    size_t len;
+    CommandId id;
+    int arity;
+    uint8_t flags;
+    int firstKey;
+    int lastKey;
+    int keyStep;
+
+    constexpr CommandSpec(const char* name, CommandId id, int arity, uint8_t flags,
+                          int firstKey, int lastKey, int keyStep)
+        : name(name), len(lengthOf(name)), id(id), arity(arity), flags(flags),
+          firstKey(firstKey), lastKey(lastKey), keyStep(keyStep) {}
+
+    bool arityOk(size_t argc) const {
+        return arity >= 0 ? argc == static_cast<size_t>(arity) : argc >= static_cast<size_t>(-arity);
+    }
+
+private:
+    static constexpr size_t lengthOf(const char* s) {
+        size_t n = 0;
+        while (s[n]) ++n;
+        return n;
+    }
+};
+
+inline constexpr CommandSpec COMMAND_SPECS[CMD_COUNT] = {
+    {"set",           CMD_SET,            -3, CMD_WRITE,                1,  1, 1},
+    {"get",           CMD_GET,             2, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"del",           CMD_DEL,            -2, CMD_WRITE,                1, -1, 1},
+    {"exists",        CMD_EXISTS,         -2, CMD_READONLY | CMD_FAST,  1, -1, 1},
+    {"incr",          CMD_INCR,            2, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"decr",          CMD_DECR,            2, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"incrby",        CMD_INCRBY,          3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"decrby",        CMD_DECRBY,          3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"keys",          CMD_KEYS,            2, CMD_READONLY,             0,  0, 0},
+    {"scan",          CMD_SCAN,           -2, CMD_READONLY,             0,  0, 0},
+    {"flushall",      CMD_FLUSHALL,       -1, CMD_WRITE,                0,  0, 0},
+    {"ping",          CMD_PING,           -1, CMD_FAST,                 0,  0, 0},
+    {"quit",          CMD_QUIT,           -1, CMD_FAST,                 0,  0, 0},
+    {"info",          CMD_INFO,           -1, 0,                        0,  0, 0},
+    {"command",       CMD_COMMAND,        -1, 0,                        0,  0, 0},
+    {"type",          CMD_TYPE,            2, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"hset",          CMD_HSET,           -4, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"hget",          CMD_HGET,            3, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"hdel",          CMD_HDEL,           -3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"hgetall",       CMD_HGETALL,         2, CMD_READONLY,             1,  1, 1},
+    {"hlen",          CMD_HLEN,            2, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"hexists",       CMD_HEXISTS,         3, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"hincrby",       CMD_HINCRBY,         4, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"lpush",         CMD_LPUSH,          -3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"rpush",         CMD_RPUSH,          -3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"lpop",          CMD_LPOP,            2, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"rpop",          CMD_RPOP,            2, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"llen",          CMD_LLEN,            2, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"lrange",        CMD_LRANGE,          4, CMD_READONLY,             1,  1, 1},
+    {"lindex",        CMD_LINDEX,          3, CMD_READONLY,             1,  1, 1},
+    {"sadd",          CMD_SADD,           -3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"srem",          CMD_SREM,           -3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"sismember",     CMD_SISMEMBER,       3, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"smembers",      CMD_SMEMBERS,        2, CMD_READONLY,             1,  1, 1},
+    {"scard",         CMD_SCARD,           2, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"zadd",          CMD_ZADD,           -4, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"zrem",          CMD_ZREM,           -3, CMD_WRITE | CMD_FAST,     1,  1, 1},
+    {"zscore",        CMD_ZSCORE,          3, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"zcard",         CMD_ZCARD,           2, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"zrank",         CMD_ZRANK,           3, CMD_READONLY | CMD_FAST,  1,  1, 1},
+    {"zrange",        CMD_ZRANGE,         -4, CMD_READONLY,             1,  1, 1},
+    {"zrangebyscore", CMD_ZRANGEBYSCORE,  -4, CMD_READONLY,             1,  1, 1},
+};
+
+// Name -> CommandSpec through a perfect hash built at compile time.
+//
+// The hash is FNV-1a over the name with bit 5 of every byte set, which folds
+// ASCII letters to lower case; the seed is the first one for which every name
+// lands in its own slot, found by the compiler, so a lookup is one hash, one
+// slot read and one length-checked compare, with no allocation and no probing.
+// Names are letters only, so setting bit 5 on the compared bytes matches them
+// case-insensitively and nothing else.
+class CommandTable {
+public:
+    static constexpr size_t SLOTS = 256;
+    static_assert(SLOTS >= 2 * CMD_COUNT && (SLOTS & (SLOTS - 1)) == 0, "grow SLOTS with the table");
+
+    // nullptr if name is not a known command
+    static const CommandSpec* find(std::string_view name) {
+        const Slots& table = slots();
+        uint8_t index = table.index[hash(table.seed, name.data(), name.size()) & (SLOTS - 1)];
+        if (index == EMPTY) return nullptr;
+        const CommandSpec& spec = COMMAND_SPECS[index];
+        return spec.len == name.size() && sameName(spec.name, name.data(), name.size()) ? &spec : nullptr;
+    }
+
+    static bool is(std::string_view name, CommandId id) {
+        const CommandSpec* spec = find(name);
+        return spec && spec->id == id;
+    }
+
+    // Whether an argument is the given keyword (lower case letters), ignoring case
+    static bool isKeyword(std::string_view arg, const char* lower) {
+        return arg.size() == std::char_traits<char>::length(lower) && sameName(lower, arg.data(), arg.size());
+    }
+
+    static std::string arityError(const CommandSpec& spec) {
+        return "-ERR wrong number of arguments for '" + std::string(spec.name) + "' command\r\n";
+    }
+
+    // COMMAND [COUNT | INFO name ...]; supported(id) says whether the caller
+    // has a handler for a command, and only those are listed
+    template <typename Supported>
+    static std::string reply(const std::vector<std::string_view>& argv, Supported supported) {
+        if (argv.size() == 1) {
+            size_t count = 0;
+            std::string body;
+            for (const CommandSpec& spec : COMMAND_SPECS) {
+                if (!supported(spec.id)) continue;
+                count++;
+                body += info(spec);
+            }
+            return "*" + std::to_string(count) + "\r\n" + body;
+        }
+
+        if (isKeyword(argv[1], "count")) {
+            if (argv.size() != 2) return "-ERR wrong number of arguments for 'command|count' command\r\n";
+            size_t count = 0;
+            for (const CommandSpec& spec : COMMAND_SPECS) {
+                if (supported(spec.id)) count++;
+            }
+            return ":" + std::to_string(count) + "\r\n";
+        }
+
+        if (isKeyword(argv[1], "info")) {
+            std::string out = "*" + std::to_string(argv.size() - 2) + "\r\n";
+            for (size_t i = 2; i < argv.size(); ++i) {
+                const CommandSpec* spec = find(argv[i]);
+                out += spec && supported(spec->id) ? info(*spec) : "*-1\r\n";
+            }
+            return out;
+        }
+
+        return "-ERR unknown subcommand '" + std::string(argv[1]) + "'. Try COMMAND INFO or COMMAND COUNT.\r\n";
+    }
+
+private:
+    static constexpr uint8_t EMPTY = 0xff;
+
+    struct Slots {
+        uint32_t seed = 0;
+        uint8_t index[SLOTS] = {};
+    };
+
+    static constexpr uint32_t hash(uint32_t seed, const char* s, size_t n) {
+        uint32_t h = 2166136261u ^ seed;
+        for (size_t i = 0; i < n; ++i) {
+            h = (h ^ static_cast<uint8_t>(s[i] | 0x20)) * 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    // lower is one of the table's names; s matches it ignoring case
+    static constexpr bool sameName(const char* lower, const char* s, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            if (!lower[i] || static_cast<char>(s[i] | 0x20) != lower[i]) return false;
+        }
+        return true;
+    }
+
+    static constexpr bool place(uint32_t seed, Slots& table) {
+        for (size_t i = 0; i < SLOTS; ++i) table.index[i] = EMPTY;
+        for (size_t i = 0; i < CMD_COUNT; ++i) {
+            const CommandSpec& spec = COMMAND_SPECS[i];
+            if (spec.id != i) return false;  // the array must be in CommandId order
+            for (size_t j = 0; j < spec.len; ++j) {
+                if (spec.name[j] < 'a' || spec.name[j] > 'z') return false;
+            }
+            uint8_t& slot = table.index[hash(seed, spec.name, spec.len) & (SLOTS - 1)];
+            if (slot != EMPTY) return false;
+            slot = static_cast<uint8_t>(i);
+        }
+        table.seed = seed;
+        return true;
+    }
+
+    static constexpr Slots build() {
+        Slots table;
+        for (uint32_t seed = 1; seed < 100000; ++seed) {
+            if (place(seed, table)) return table;
+        }
+        table.seed = 0;
+        return table;
+    }
+
+    static const Slots& slots() {
+        static constexpr Slots TABLE = build();
+        static_assert(TABLE.seed != 0, "no collision-free seed: check COMMAND_SPECS or grow SLOTS");
+        return TABLE;
+    }
+
+    static std::string info(const CommandSpec& spec) {
+        static const char* const FLAG_NAMES[] = {"write", "readonly", "fast"};
+        std::string flags;
+        size_t flagCount = 0;
+        for (size_t bit = 0; bit < 3; ++bit) {
+            if (!(spec.flags & (1u << bit))) continue;
+            flagCount++;
+            flags += "+" + std::string(FLAG_NAMES[bit]) + "\r\n";
+        }
+        return "*6\r\n$" + std::to_string(spec.len) + "\r\n" + spec.name + "\r\n" +
+               ":" + std::to_string(spec.arity) + "\r\n" +
+               "*" + std::to_string(flagCount) + "\r\n" + flags +
+               ":" + std::to_string(spec.firstKey) + "\r\n" +
+               ":" + std::to_string(spec.lastKey) + "\r\n" +
+               ":" + std::to_string(spec.keyStep) + "\r\n";
+    }
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MPMC_QUEUE_PAUSE() _mm_pause()
+#else
+    #define MPMC_QUEUE_PAUSE() std::this_thread::yield()
+#endif
+
+// Bounded multi-producer multi-consumer queue, after Dmitry Vyukov's ring.
+//
+// Each cell carries a sequence number saying whose turn it is, so a push or a
+// pop is one CAS on the shared position plus a store to the cell; nobody takes
+// a lock and the ring never allocates after construction. T is meant to be a
+// small trivially copyable descriptor (a pointer, an index). The capacity is
+// rounded up to a power of two, and to at least 2: with one cell, a consumed
+// cell's sequence number would read as full to the next producer.
+//
+// Consumers that find the ring empty spin for a while before parking on a
+// condition variable. The spin adapts per consumer: it doubles whenever an item
+// shows up mid-spin and halves whenever the spin ends in a park, so an idle
+// pool stops burning CPU and a busy one rarely sleeps. Producers only touch the
+// mutex when somebody is parked.
+template <typename T>
+class MpmcQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "MpmcQueue holds descriptors, not owning objects");
+
+public:
+    static constexpr unsigned MIN_SPIN = 16;
+    static constexpr unsigned MAX_SPIN = 2048;
+
+    // Per-consumer spin state; each thread calling pop() keeps its own
+    struct Consumer {
+        unsigned spin = MIN_SPIN;
+    };
+
+    explicit MpmcQueue(size_t capacity)
+        : capacity_(roundUp(capacity)),
+          mask_(capacity_ - 1),
+          cells_(new Cell[capacity_]),
+          maxSpin_(std::thread::hardware_concurrency() > 1 ? MAX_SPIN : 0) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+    // Appends item and wakes a parked consumer; returns false if the queue is full
+    bool push(const T& item) {
+        if (!tryPush(item)) return false;
+        // Pairs with the fence in pop(): either we see the sleeper or it sees the item
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) > 0) {
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            wake_.notify_one();
+        }
+        return true;
+    }
+
+    bool tryPush(const T& item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        item = cell->item;
+        cell->seq.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+    // Takes the next item, spinning and then parking while the queue is empty.
+    // Returns false once stop is set and the queue has drained.
+    bool pop(T& item, Consumer& self, const std::atomic<bool>& stop) {
+        if (tryPop(item)) return true;
+
+        unsigned limit = std::min(self.spin, maxSpin_);
+        for (unsigned i = 0; i < limit; ++i) {
+            MPMC_QUEUE_PAUSE();
+            if (tryPop(item)) {
+                self.spin = std::min(limit * 2, MAX_SPIN);
+                return true;
+            }
+        }
+        self.spin = std::max(limit / 2, MIN_SPIN);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleepers_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool got;
+        while (!(got = tryPop(item)) && !stop.load()) {
+            wake_.wait(lock);
+        }
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return got;
+    }
+
+    // Wakes every parked consumer, e.g. after setting the stop flag
+    void wakeAll() {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        wake_.notify_all();
+    }
+
+private:
+    static size_t roundUp(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        T item;
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    const unsigned maxSpin_;  // 0 on a single CPU, where spinning only delays the producer
+
+    // Producers and consumers each hammer their own position; keep them apart
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<int> sleepers_{0};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+};
+
+#endif
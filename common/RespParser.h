@@ -0,0 +1,223 @@
+#ifndef RESP_PARSER_H
+#define RESP_PARSER_H
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+// Incremental RESP2 request parser.
+//
+// Works in place on a connection's read buffer: every parsed argument is a
+// string_view into that buffer, so nothing is copied. Accepts both multibulk
+// arrays (*N\r\n$len\r\n...) and inline commands ("SET k v\r\n"). When a frame
+// is cut short, parse() reports how many bytes it needs so callers can skip
+// re-parsing until that much has arrived.
+class RespParser {
+public:
+    enum Status { Ok, Incomplete, Error };
+
+    static constexpr long long MAX_BULK_LEN = 512LL * 1024 * 1024;
+    static constexpr long long MAX_MULTIBULK_LEN = 1024 * 1024;
+    static constexpr size_t MAX_INLINE_LEN = 64 * 1024;
+
+    // Parses one request at data[0..len).
+    //   Ok         - consumed is the frame size; argv holds its arguments
+    //                (empty for a blank line or an empty array).
+    //   Incomplete - needed is the minimum buffer size worth retrying with.
+    //   Error      - error is a ready-to-send "-ERR Protocol error" reply.
+    static Status parse(const char* data, size_t len, size_t& consumed,
+                        std::vector<std::string_view>& argv, size_t& needed,
+                        const char*& error) {
+        argv.clear();
+        if (len == 0) {
+            needed = 1;
+            return Incomplete;
+        }
+        if (data[0] == '*') {
+            return parseMultibulk(data, len, consumed, argv, needed, error);
+        }
+        return parseInline(data, len, consumed, argv, needed, error);
+    }
+
+    static bool isMultibulk(const char* data) { return data[0] == '*'; }
+
+    // Finds the end of one complete RESP2 reply at data[0..len) without
+    // decoding it, so a proxy can forward replies verbatim.
+    //   Ok         - consumed is the reply size (nested arrays included).
+    //   Incomplete - more bytes are needed.
+    //   Error      - the stream is not valid RESP.
+    static Status scanReply(const char* data, size_t len, size_t& consumed) {
+        size_t pos = 0;
+        long long pending = 1;  // values still to read; arrays add their elements
+        size_t needed = 0;
+        const char* error = nullptr;
+
+        while (pending > 0) {
+            if (pos >= len) return Incomplete;
+            char type = data[pos++];
+
+            if (type == '+' || type == '-' || type == ':') {
+                size_t cr = findCrlf(data, len, pos);
+                if (cr == std::string_view::npos) return Incomplete;
+                pos = cr + 2;
+                pending--;
+            } else if (type == '$' || type == '*') {
+                long long n = 0;
+                Status st = readLength(data, len, pos, n, needed, error, "");
+                if (st != Ok) return st;
+                pending--;
+                if (n < 0) continue;  // null bulk or null array
+                if (type == '*') {
+                    if (n > MAX_MULTIBULK_LEN) return Error;
+                    pending += n;
+                    continue;
+                }
+                size_t end = pos + static_cast<size_t>(n);
+                if (end + 2 > len) return Incomplete;
+                if (data[end] != '\r' || data[end + 1] != '\n') return Error;
+                pos = end + 2;
+            } else {
+                return Error;
+            }
+        }
+
+        consumed = pos;
+        return Ok;
+    }
+
+private:
+    // Finds "\r\n" at or after pos; returns the index of '\r' or npos.
+    static size_t findCrlf(const char* data, size_t len, size_t pos) {
+        while (pos + 1 < len) {
+            const void* cr = std::memchr(data + pos, '\r', len - pos - 1);
+            if (!cr) return std::string_view::npos;
+            size_t at = static_cast<const char*>(cr) - data;
+            if (data[at + 1] == '\n') return at;
+            pos = at + 1;
+        }
+        return std::string_view::npos;
+    }
+
+    // Reads the integer between data[pos] and the next CRLF; pos ends past the CRLF.
+    static Status readLength(const char* data, size_t len, size_t& pos, long long& out,
+                             size_t& needed, const char*& error, const char* badLenError) {
+        size_t cr = findCrlf(data, len, pos);
+        if (cr == std::string_view::npos) {
+            if (len - pos > 32) {
+                error = badLenError;
+                return Error;
+            }
+            needed = len + 1;
+            return Incomplete;
+        }
+
+        bool negative = false;
+        size_t i = pos;
+        if (i < cr && data[i] == '-') {
+            negative = true;
+            ++i;
+        }
+        if (i == cr) {
+            error = badLenError;
+            return Error;
+        }
+
+        long long v = 0;
+        for (; i < cr; ++i) {
+            char c = data[i];
+            if (c < '0' || c > '9' || v > MAX_BULK_LEN) {
+                error = badLenError;
+                return Error;
+            }
+            v = v * 10 + (c - '0');
+        }
+        out = negative ? -v : v;
+        pos = cr + 2;
+        return Ok;
+    }
+
+    static Status parseMultibulk(const char* data, size_t len, size_t& consumed,
+                                 std::vector<std::string_view>& argv, size_t& needed,
+                                 const char*& error) {
+        size_t pos = 1;
+        long long count = 0;
+        Status st = readLength(data, len, pos, count, needed, error,
+                               "-ERR Protocol error: invalid multibulk length\r\n");
+        if (st != Ok) return st;
+        if (count > MAX_MULTIBULK_LEN) {
+            error = "-ERR Protocol error: invalid multibulk length\r\n";
+            return Error;
+        }
+        if (count <= 0) {
+            consumed = pos;
+            return Ok;
+        }
+
+        argv.reserve(static_cast<size_t>(count));
+        for (long long i = 0; i < count; ++i) {
+            if (pos >= len) {
+                needed = pos + 1;
+                return Incomplete;
+            }
+            if (data[pos] != '$') {
+                error = "-ERR Protocol error: expected '$'\r\n";
+                return Error;
+            }
+            ++pos;
+
+            long long bulkLen = 0;
+            st = readLength(data, len, pos, bulkLen, needed, error,
+                            "-ERR Protocol error: invalid bulk length\r\n");
+            if (st != Ok) return st;
+            if (bulkLen < 0 || bulkLen > MAX_BULK_LEN) {
+                error = "-ERR Protocol error: invalid bulk length\r\n";
+                return Error;
+            }
+
+            size_t end = pos + static_cast<size_t>(bulkLen);
+            if (end + 2 > len) {
+                needed = end + 2;
+                return Incomplete;
+            }
+            if (data[end] != '\r' || data[end + 1] != '\n') {
+                error = "-ERR Protocol error: expected CRLF after bulk\r\n";
+                return Error;
+            }
+            argv.emplace_back(data + pos, static_cast<size_t>(bulkLen));
+            pos = end + 2;
+        }
+
+        consumed = pos;
+        return Ok;
+    }
+
+    static Status parseInline(const char* data, size_t len, size_t& consumed,
+                              std::vector<std::string_view>& argv, size_t& needed,
+                              const char*& error) {
+        const void* nl = std::memchr(data, '\n', len);
+        if (!nl) {
+            if (len > MAX_INLINE_LEN) {
+                error = "-ERR Protocol error: too big inline request\r\n";
+                return Error;
+            }
+            needed = len + 1;
+            return Incomplete;
+        }
+
+        size_t lineEnd = static_cast<const char*>(nl) - data;
+        consumed = lineEnd + 1;
+        if (lineEnd > 0 && data[lineEnd - 1] == '\r') --lineEnd;
+
+        size_t i = 0;
+        while (i < lineEnd) {
+            while (i < lineEnd && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r')) ++i;
+            size_t start = i;
+            while (i < lineEnd && data[i] != ' ' && data[i] != '\t' && data[i] != '\r') ++i;
+            if (i > start) argv.emplace_back(data + start, i - start);
+        }
+        return Ok;
+    }
+};
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef ROUTING_TABLE_H
+#define ROUTING_TABLE_H
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/types.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+#endif
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstdlib>
+
+// Where a tenant's node lives.
+struct NodeRoute {
+    std::string host;
+    int port = 0;
+    std::string address;  // host resolved to a numeric IPv4 address, empty if unresolved
+};
+
+// Tenant -> node placement, read on every connection and rewritten rarely.
+//
+// The whole map is immutable once published: a writer copies it, applies its
+// changes and swaps the shared_ptr in. Each reader thread keeps the snapshot it
+// last used together with the version it was published under, so a lookup is
+// one atomic load of the version plus a hash probe and takes no lock; only the
+// first lookup after a swap reloads the pointer. A thread holds on to at most
+// one retired map until its next lookup.
+class RoutingTable {
+public:
+    using Map = std::unordered_map<std::string, NodeRoute>;
+
+    RoutingTable() : current_(std::make_shared<const Map>()) {}
+
+    bool lookup(const std::string& tenantId, NodeRoute& route) const {
+        const Map& map = *snapshot();
+        auto it = map.find(tenantId);
+        if (it == map.end()) return false;
+        route = it->second;
+        return true;
+    }
+
+    std::shared_ptr<const Map> snapshot() const {
+        struct Cached {
+            const RoutingTable* table = nullptr;
+            uint64_t version = 0;
+            std::shared_ptr<const Map> map;
+        };
+        thread_local Cached cached;
+
+        uint64_t version = version_.load(std::memory_order_acquire);
+        if (cached.table != this || cached.version != version) {
+            cached.map = std::atomic_load(&current_);
+            cached.table = this;
+            cached.version = version;
+        }
+        return cached.map;
+    }
+
+    // Opaque position to send as ?since= on the next incremental poll
+    long long cursor() const { return cursor_.load(); }
+
+    size_t size() const { return snapshot()->size(); }
+
+    // Applies one GET /api/routes response:
+    //   {"cursor":<n>,"routes":[{"tenant_id":"...","node_host":"...",
+    //     "node_port":6001,"status":"active"}, ...]}
+    // A full response (since=0) replaces the table; a delta only touches the
+    // tenants it lists, and a tenant whose status is not "active" is dropped.
+    // Hosts are resolved here, on the polling thread, never on the lookup path.
+    // Returns false if the body is not a routes response.
+    bool apply(const std::string& body, bool full) {
+        long long nextCursor = 0;
+        if (!readNumber(body, "cursor", nextCursor)) return false;
+        size_t array = body.find("\"routes\"");
+        if (array == std::string::npos) return false;
+        array = body.find('[', array);
+        if (array == std::string::npos) return false;
+
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::shared_ptr<const Map> old = std::atomic_load(&current_);
+        auto next = std::make_shared<Map>();
+        if (!full) *next = *old;
+
+        // Addresses already known, so a poll only resolves hosts it has not seen
+        std::unordered_map<std::string, std::string> resolved;
+        if (!full) {
+            for (const auto& entry : *old) {
+                resolved.emplace(entry.second.host, entry.second.address);
+            }
+        }
+
+        size_t pos = array + 1;
+        while (true) {
+            size_t open = body.find_first_of("{]", pos);
+            if (open == std::string::npos || body[open] == ']') break;
+            size_t close = body.find('}', open);
+            if (close == std::string::npos) return false;
+            std::string_view object(body.data() + open, close - open + 1);
+            pos = close + 1;
+
+            std::string tenantId, status;
+            NodeRoute route;
+            long long port = 0;
+            if (!readString(object, "tenant_id", tenantId)) continue;
+            readString(object, "status", status);
+            readString(object, "node_host", route.host);
+            readNumber(object, "node_port", port);
+            route.port = static_cast<int>(port);
+
+            if (status != "active" || route.host.empty() || route.port <= 0) {
+                next->erase(tenantId);
+                continue;
+            }
+
+            auto known = resolved.find(route.host);
+            if (known == resolved.end() || known->second.empty()) {
+                known = resolved.insert_or_assign(route.host, resolve(route.host)).first;
+            }
+            route.address = known->second;
+            (*next)[tenantId] = std::move(route);
+        }
+
+        std::atomic_store(&current_, std::shared_ptr<const Map>(std::move(next)));
+        cursor_.store(nextCursor);
+        version_.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    // Looks up host's first IPv4 address; numeric hosts come back unchanged
+    static std::string resolve(const std::string& host) {
+        in_addr numeric;
+        if (inet_pton(AF_INET, host.c_str(), &numeric) == 1) return host;
+
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) return "";
+
+        char text[INET_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr,
+                  text, sizeof(text));
+        freeaddrinfo(result);
+        return text;
+    }
+
+private:
+    std::shared_ptr<const Map> current_;       // only touched through atomic_load/atomic_store
+    std::atomic<uint64_t> version_{1};
+    std::atomic<long long> cursor_{0};
+    std::mutex writeMutex_;
+
+    // Finds "name": and returns the offset of its value, skipping whitespace
+    static size_t valueOf(std::string_view json, const char* name) {
+        std::string quoted = std::string("\"") + name + "\"";
+        size_t pos = json.find(quoted);
+        if (pos == std::string_view::npos) return pos;
+        pos = json.find(':', pos + quoted.size());
+        if (pos == std::string_view::npos) return pos;
+        pos++;
+        while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' ||
+                                     json[pos] == '\r' || json[pos] == '\n')) {
+            pos++;
+        }
+        return pos < json.size() ? pos : std::string_view::npos;
+    }
+
+    static bool readString(std::string_view json, const char* name, std::string& out) {
+        size_t pos = valueOf(json, name);
+        if (pos == std::string_view::npos || json[pos] != '"') return false;
+        size_t end = json.find('"', pos + 1);
+        if (end == std::string_view::npos) return false;
+        out.assign(json.data() + pos + 1, end - pos - 1);
+        return true;
+    }
+
+    static bool readNumber(std::string_view json, const char* name, long long& out) {
+        size_t pos = valueOf(json, name);
+        if (pos == std::string_view::npos) return false;
+        char* end = nullptr;
+        std::string digits(json.substr(pos, 24));
+        out = std::strtoll(digits.c_str(), &end, 10);
+        return end != digits.c_str();
+    }
+};
+
+// Keeps a RoutingTable in step with the backend by polling GET /api/routes.
+// Each poll asks only for tenants changed since the previous one; every
+// resyncInterval it fetches the full table instead, which also drops tenants
+// deleted outright and picks up node addresses that changed behind a hostname.
+class RoutePoller {
+public:
+    // fetch performs a GET for the given path and returns the body, or "" on failure
+    using Fetch = std::function<std::string(const std::string& path)>;
+
+    RoutePoller(RoutingTable& table, Fetch fetch,
+                std::chrono::milliseconds interval, std::chrono::seconds resyncInterval)
+        : table_(table), fetch_(std::move(fetch)), interval_(interval),
+          resyncInterval_(resyncInterval) {}
+
+    ~RoutePoller() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    void start() {
+        thread_ = std::thread(&RoutePoller::run, this);
+    }
+
+    // Asks for an immediate poll (e.g. after a lookup miss for a tenant created
+    // since the last one) and waits up to timeout for it to finish. Concurrent
+    // callers share the same poll.
+    bool refreshNow(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = started_ + 1;  // a poll already in flight may predate the caller
+        wanted_ = true;
+        wake_.notify_all();
+        return done_.wait_for(lock, timeout, [&] { return finished_ >= target; });
+    }
+
+    // Like refreshNow, but returns at once and calls done on the polling thread
+    // when that poll has finished, for callers that must not block.
+    void refreshAsync(std::function<void()> done) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            asyncWaiters_.emplace_back(started_ + 1, std::move(done));
+            wanted_ = true;
+        }
+        wake_.notify_all();
+    }
+
+private:
+    RoutingTable& table_;
+    Fetch fetch_;
+    std::chrono::milliseconds interval_;
+    std::chrono::seconds resyncInterval_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool wanted_ = false;
+    bool stopping_ = false;
+    uint64_t started_ = 0;   // polls begun
+    uint64_t finished_ = 0;  // polls completed, successful or not
+    std::vector<std::pair<uint64_t, std::function<void()>>> asyncWaiters_;  // (poll, callback)
+
+    void run() {
+        auto lastFull = std::chrono::steady_clock::time_point();
+        bool synced = false;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) return;
+                started_++;
+                wanted_ = false;
+            }
+            auto now = std::chrono::steady_clock::now();
+            bool full = !synced || now - lastFull >= resyncInterval_;
+            std::string path = "/api/routes?since=" + std::to_string(full ? 0 : table_.cursor());
+
+            std::string body = fetch_(path);
+            if (!body.empty() && table_.apply(body, full)) {
+                if (full) {
+                    lastFull = now;
+                    synced = true;
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            finished_ = started_;
+            done_.notify_all();
+
+            std::vector<std::function<void()>> ready;
+            for (size_t i = 0; i < asyncWaiters_.size();) {
+                if (asyncWaiters_[i].first <= finished_) {
+                    ready.push_back(std::move(asyncWaiters_[i].second));
+                    asyncWaiters_[i] = std::move(asyncWaiters_.back());
+                    asyncWaiters_.pop_back();
+                } else {
+                    i++;
+                }
+            }
+            if (!ready.empty()) {
+                lock.unlock();
+                for (auto& callback : ready) callback();
+                lock.lock();
+            }
+
+            wake_.wait_for(lock, interval_, [&] { return wanted_ || stopping_; });
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,412 @@
+#ifndef SWISS_TABLE_H
+#define SWISS_TABLE_H
+
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SWISS_TABLE_SSE2 1
+#endif
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+#ifdef __linux__
+    #include <sys/mman.h>
+#endif
+
+// Open-addressing hash table keyed by strings, in the Swiss-table layout.
+//
+// Slots live in one flat array next to an array of control bytes. A control
+// byte is EMPTY, DELETED, or the low 7 bits of the hash of the key in its slot
+// (a fingerprint). Probing walks groups of 16 control bytes and checks a
+// fingerprint against a whole group at once (one SSE2 compare where the CPU has
+// it), so keys are only compared on a fingerprint hit and most misses never
+// touch a slot. Lookups take a string_view; nobody builds a std::string to
+// search.
+//
+// Growth is incremental, like Redis's dual-table dict: once the table passes
+// 7/8 full, a table sized for twice the keys becomes active and the old one is
+// drained group by group. Every insert and erase moves up to MIGRATE_GROUPS
+// groups, and the owner calls rehashStep() from a background thread to finish
+// the job while the table is idle. Until the old table is empty, lookups check
+// both and iteration covers both. No call spends more than the rehash budget
+// migrating, and the arrays of a new table come from calloc, so starting a
+// resize costs no pass over the slots and the pause never grows with the
+// keyspace.
+//
+// Slot stores its own key; KeyOf(slot) returns it as a string_view. Slot
+// pointers stay valid until the next insert or erase. Not thread-safe: callers
+// lock around it, and concurrent lookups are safe only while nobody writes.
+template <typename Slot, typename KeyOf>
+class SwissTable {
+public:
+    static constexpr size_t GROUP = 16;
+    static constexpr size_t MIGRATE_GROUPS = 2;
+    static constexpr std::chrono::microseconds DEFAULT_REHASH_BUDGET{100};
+    // What one key costs in the table itself (slot plus control byte)
+    static constexpr size_t SLOT_BYTES = sizeof(Slot) + 1;
+
+    SwissTable() = default;
+    ~SwissTable() {
+        release(active_);
+        release(old_);
+    }
+    SwissTable(const SwissTable&) = delete;
+    SwissTable& operator=(const SwissTable&) = delete;
+
+    static size_t hashOf(std::string_view key) { return std::hash<std::string_view>{}(key); }
+
+    size_t size() const { return active_.size + old_.size; }
+    bool empty() const { return size() == 0; }
+    bool migrating() const { return old_.ctrl != nullptr; }
+
+    // Longest time one insert, erase or rehashStep() may spend moving slots.
+    // Each call still moves at least one group, so a migration always ends.
+    void setRehashBudget(std::chrono::microseconds budget) { budget_ = budget; }
+
+    // Migrates for up to the rehash budget; returns whether a migration is
+    // still in progress. Meant for a background thread holding the table's lock.
+    bool rehashStep() {
+        step(SIZE_MAX);
+        return migrating();
+    }
+
+    // Bytes held by the slot and control arrays of both tables
+    size_t tableBytes() const { return (active_.capacity() + old_.capacity()) * SLOT_BYTES; }
+
+    Slot* find(std::string_view key) { return find(key, hashOf(key)); }
+
+    Slot* find(std::string_view key, size_t hash) {
+        if (Slot* slot = findIn(active_, key, hash)) return slot;
+        return old_.ctrl ? findIn(old_, key, hash) : nullptr;
+    }
+
+    const Slot* find(std::string_view key, size_t hash) const {
+        return const_cast<SwissTable*>(this)->find(key, hash);
+    }
+
+    // Adds slot, whose key must not be in the table yet, and returns where it landed
+    Slot* insert(Slot&& slot, size_t hash) {
+        step(MIGRATE_GROUPS);
+        if (active_.size + active_.deleted + 1 > maxLoad(active_) && !old_.ctrl) {
+            grow();
+        }
+        return place(active_, hash, std::move(slot));
+    }
+
+    // Removes the slot a find() returned
+    void erase(Slot* slot) {
+        bool inOld = old_.ctrl && slot >= old_.slots && slot < old_.slots + old_.capacity();
+        Table& t = inOld ? old_ : active_;
+        size_t i = static_cast<size_t>(slot - t.slots);
+
+        // A group that already has an empty slot ends every probe through it,
+        // so the freed slot can be EMPTY; otherwise it must keep probes going.
+        if (matchEmpty(t.ctrl + (i & ~(GROUP - 1)))) {
+            t.ctrl[i] = EMPTY;
+        } else {
+            t.ctrl[i] = DELETED;
+            t.deleted++;
+        }
+        slot->~Slot();
+        t.size--;
+        step(MIGRATE_GROUPS);
+    }
+
+    void clear() {
+        release(active_);
+        release(old_);
+        active_ = Table();
+        old_ = Table();
+    }
+
+    template <typename F>
+    void forEach(F f) {
+        forEachIn(old_, f);
+        forEachIn(active_, f);
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        const_cast<SwissTable*>(this)->forEach([&f](const Slot& slot) { f(slot); });
+    }
+
+    // Positions 0..slotCount() cover every slot of both tables; slotAt() is
+    // null for a free one. Lets callers sample random keys.
+    size_t slotCount() const { return old_.capacity() + active_.capacity(); }
+
+    Slot* slotAt(size_t i) {
+        const Table& t = i < old_.capacity() ? old_ : active_;
+        if (&t == &active_) i -= old_.capacity();
+        return isFull(t.ctrl[i]) ? &t.slots[i] : nullptr;
+    }
+
+    // Incremental walk, after Redis's dictScan. Each call visits the keys whose
+    // home group is the one cursor names (in both tables while migrating) and
+    // returns the cursor for the next call, 0 once the walk is done; start at
+    // 0. The cursor counts with its bits reversed, so when the table doubles
+    // the groups already walked split into groups that are also behind it, and
+    // when it shrinks they fold into ones still ahead. A key present for the
+    // whole walk is therefore visited at least once whatever the table does in
+    // between; a key may be visited twice if the table shrank. Nothing is kept
+    // between calls.
+    template <typename F>
+    size_t scan(size_t cursor, F f) {
+        if (!old_.ctrl) {
+            if (active_.groups == 0) return 0;
+            size_t mask = active_.groups - 1;
+            scanHome(active_, cursor & mask, f);
+            return nextCursor(cursor, mask);
+        }
+
+        const Table& small = old_.groups <= active_.groups ? old_ : active_;
+        const Table& large = &small == &old_ ? active_ : old_;
+        size_t m0 = small.groups - 1;
+        size_t m1 = large.groups - 1;
+        scanHome(small, cursor & m0, f);
+        // Then every group of the larger table that folds onto that one
+        do {
+            scanHome(large, cursor & m1, f);
+            cursor = nextCursor(cursor, m1);
+        } while (cursor & (m0 ^ m1));
+        return cursor;
+    }
+
+private:
+    // A full slot's control byte is FULL | fingerprint. EMPTY is zero so a
+    // table's control bytes can come straight from calloc.
+    static constexpr uint8_t EMPTY = 0x00;
+    static constexpr uint8_t DELETED = 0x01;
+    static constexpr uint8_t FULL = 0x80;
+
+    struct Table {
+        uint8_t* ctrl = nullptr;
+        Slot* slots = nullptr;
+        size_t groups = 0;   // power of two; 0 until the first insert
+        size_t size = 0;     // live slots
+        size_t deleted = 0;  // DELETED control bytes
+
+        size_t capacity() const { return groups * GROUP; }
+    };
+
+    Table active_;
+    Table old_;          // being drained into active_, empty when not growing
+    size_t cursor_ = 0;  // next group of old_ to drain
+    size_t trimmed_ = 0; // bytes at the start of old_.slots already returned to the OS
+    std::chrono::nanoseconds budget_ = DEFAULT_REHASH_BUDGET;
+
+    static bool isFull(uint8_t ctrl) { return (ctrl & FULL) != 0; }
+    static uint8_t fingerprint(size_t hash) { return static_cast<uint8_t>(FULL | (hash & 0x7F)); }
+    static size_t homeGroup(const Table& t, size_t hash) { return (hash >> 7) & (t.groups - 1); }
+    static size_t maxLoad(const Table& t) { return t.capacity() - t.capacity() / 8; }
+
+    static uint32_t matchByte(const uint8_t* group, uint8_t b) {
+#ifdef SWISS_TABLE_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(b)))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP; ++i) {
+            if (group[i] == b) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    static uint32_t matchEmpty(const uint8_t* group) { return matchByte(group, EMPTY); }
+
+    // EMPTY or DELETED: the control bytes without the FULL bit
+    static uint32_t matchFree(const uint8_t* group) {
+#ifdef SWISS_TABLE_SSE2
+        return ~static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(group)))) & 0xFFFF;
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP; ++i) {
+            if (!isFull(group[i])) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    static size_t lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long i;
+        _BitScanForward(&i, mask);
+        return i;
+#else
+        return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Probes group by group with triangular steps, which visits every group
+    // of a power-of-two table. A group with an EMPTY slot ends the search.
+    static Slot* findIn(const Table& t, std::string_view key, size_t hash) {
+        if (t.groups == 0) return nullptr;
+        uint8_t fp = fingerprint(hash);
+        size_t g = homeGroup(t, hash);
+        for (size_t step = 1; step <= t.groups; ++step) {
+            const uint8_t* group = t.ctrl + g * GROUP;
+            for (uint32_t m = matchByte(group, fp); m; m &= m - 1) {
+                Slot* slot = &t.slots[g * GROUP + lowestBit(m)];
+                if (KeyOf()(*slot) == key) return slot;
+            }
+            if (matchEmpty(group)) return nullptr;
+            g = (g + step) & (t.groups - 1);
+        }
+        return nullptr;
+    }
+
+    static Slot* place(Table& t, size_t hash, Slot&& slot) {
+        size_t g = homeGroup(t, hash);
+        uint32_t free = 0;
+        for (size_t step = 1; !(free = matchFree(t.ctrl + g * GROUP)); ++step) {
+            g = (g + step) & (t.groups - 1);
+        }
+        size_t i = g * GROUP + lowestBit(free);
+        if (t.ctrl[i] == DELETED) t.deleted--;
+        t.ctrl[i] = fingerprint(hash);
+        t.size++;
+        return new (&t.slots[i]) Slot(std::move(slot));
+    }
+
+    // Moves up to groups groups of old_ into active_, stopping early once the
+    // rehash budget is spent (but never before the first group). Frees old_
+    // once it is drained.
+    void step(size_t groups) {
+        if (!old_.ctrl) return;
+        auto deadline = std::chrono::steady_clock::now() + budget_;
+        for (size_t moved = 0; moved < groups && cursor_ < old_.groups && old_.size > 0; ++moved) {
+            if (moved > 0 && std::chrono::steady_clock::now() >= deadline) break;
+            for (size_t i = cursor_ * GROUP; i < (cursor_ + 1) * GROUP; ++i) {
+                if (!isFull(old_.ctrl[i])) continue;
+                Slot& slot = old_.slots[i];
+                place(active_, hashOf(KeyOf()(slot)), std::move(slot));
+                slot.~Slot();
+                // DELETED, not EMPTY: keys further along this probe chain are still in old_
+                old_.ctrl[i] = DELETED;
+                old_.size--;
+            }
+            cursor_++;
+        }
+        if (cursor_ >= old_.groups || old_.size == 0) {
+            release(old_);
+            old_ = Table();
+        } else {
+            trimDrained();
+        }
+    }
+
+    // Drained slots are never read again (their control bytes say DELETED),
+    // so their pages go back to the OS as the drain passes them. Freeing a
+    // big slot array in one go costs milliseconds of unmapping, which would
+    // land on whichever write finishes the drain. The control bytes stay:
+    // probes into old_ still walk them.
+    void trimDrained() {
+#ifdef __linux__
+        const uintptr_t page = 4096;
+        const uintptr_t chunk = 64 * 1024;  // one madvise per 64 KiB drained
+        uintptr_t base = reinterpret_cast<uintptr_t>(old_.slots);
+        uintptr_t from = (base + trimmed_ + page - 1) & ~(page - 1);
+        uintptr_t to = (base + cursor_ * GROUP * sizeof(Slot)) & ~(page - 1);
+        if (to >= from + chunk) {
+            madvise(reinterpret_cast<void*>(from), to - from, MADV_DONTNEED);
+            trimmed_ = to - base;
+        }
+#endif
+    }
+
+    // Starts draining into a table the current keys fill to at most 7/16, i.e.
+    // twice the size of a full one. Tombstones are dropped along the way, so a
+    // table full of them may come back the same size or smaller; it never
+    // shrinks by more than 4x, which keeps the drain ahead of the inserts that
+    // fill the new table (each moves at least one group).
+    void grow() {
+        size_t groups = std::max<size_t>(1, active_.groups / 4);
+        while (groups * GROUP * 7 / 16 < size()) groups *= 2;
+
+        old_ = active_;
+        cursor_ = 0;
+        trimmed_ = 0;
+        active_ = allocate(groups);
+        if (old_.size == 0) {
+            release(old_);
+            old_ = Table();
+        }
+    }
+
+    // calloc hands back fresh zero pages for big arrays, so a new table of any
+    // size is EMPTY without being touched here.
+    static Table allocate(size_t groups) {
+        Table t;
+        t.groups = groups;
+        t.ctrl = static_cast<uint8_t*>(std::calloc(t.capacity(), 1));
+        if (!t.ctrl) throw std::bad_alloc();
+        t.slots = std::allocator<Slot>().allocate(t.capacity());
+        return t;
+    }
+
+    static void release(Table& t) {
+        if (!t.ctrl) return;
+        for (size_t i = 0; t.size > 0 && i < t.capacity(); ++i) {
+            if (isFull(t.ctrl[i])) {
+                t.slots[i].~Slot();
+                t.size--;
+            }
+        }
+        std::allocator<Slot>().deallocate(t.slots, t.capacity());
+        std::free(t.ctrl);
+        t.ctrl = nullptr;
+    }
+
+    static size_t reverseBits(size_t v) {
+        size_t r = 0;
+        for (size_t i = 0; i < sizeof(size_t) * 8; ++i, v >>= 1) {
+            r = (r << 1) | (v & 1);
+        }
+        return r;
+    }
+
+    // Adds one to the cursor's bits under mask, counting from the top bit down
+    static size_t nextCursor(size_t cursor, size_t mask) {
+        cursor |= ~mask;
+        return reverseBits(reverseBits(cursor) + 1);
+    }
+
+    // Visits the keys whose home group is home. They sit along its probe chain,
+    // which ends at the first group with an EMPTY slot (findIn stops there too),
+    // so the walk is usually the home group alone.
+    template <typename F>
+    static void scanHome(const Table& t, size_t home, F& f) {
+        size_t g = home;
+        for (size_t step = 1; step <= t.groups; ++step) {
+            const uint8_t* group = t.ctrl + g * GROUP;
+            for (uint32_t m = ~matchFree(group) & 0xFFFF; m; m &= m - 1) {
+                Slot& slot = t.slots[g * GROUP + lowestBit(m)];
+                if (homeGroup(t, hashOf(KeyOf()(slot))) == home) f(slot);
+            }
+            if (matchEmpty(group)) return;
+            g = (g + step) & (t.groups - 1);
+        }
+    }
+
+    template <typename F>
+    static void forEachIn(Table& t, F& f) {
+        for (size_t i = 0; i < t.capacity(); ++i) {
+            if (isFull(t.ctrl[i])) f(t.slots[i]);
+        }
+    }
+};
+
+#endif
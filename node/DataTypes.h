@@ -0,0 +1,766 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <deque>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "../common/SwissTable.h"
+
+// glibc malloc rounds requests up to 16-byte chunks with an 8-byte header.
+inline size_t mallocSize(size_t n) {
+    size_t chunk = (n + sizeof(size_t) + 15) & ~size_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+// Heap bytes owned by a string; short strings live inline (SSO) and cost nothing extra.
+inline size_t stringHeapSize(size_t capacity) {
+    static const size_t ssoCapacity = std::string().capacity();
+    return capacity > ssoCapacity ? mallocSize(capacity + 1) : 0;
+}
+
+// A collection starts out as a Listpack and switches to its full encoding for
+// good once it holds more entries, or a longer element, than this (Redis's
+// *-max-listpack-entries and *-max-listpack-value defaults)
+const size_t LISTPACK_MAX_ENTRIES = 128;
+const size_t LISTPACK_MAX_VALUE = 64;
+
+// Short strings packed back to back in one buffer, each as a varint length and
+// its bytes, after Redis's listpack. A small collection costs one allocation,
+// and scanning a few dozen short entries beats chasing pointers. Positions are
+// byte offsets into the buffer, valid until the next insert or erase.
+class Listpack {
+public:
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    size_t bytes() const { return stringHeapSize(buf_.capacity()); }
+
+    size_t begin() const { return 0; }
+    size_t end() const { return buf_.size(); }
+
+    std::string_view at(size_t pos) const {
+        size_t len = 0;
+        size_t header = readLength(pos, len);
+        return std::string_view(buf_.data() + pos + header, len);
+    }
+
+    size_t next(size_t pos) const {
+        size_t len = 0;
+        size_t header = readLength(pos, len);
+        return pos + header + len;
+    }
+
+    // Position of the index-th entry, end() past the last
+    size_t seek(size_t index) const {
+        size_t pos = 0;
+        while (index-- > 0 && pos < end()) pos = next(pos);
+        return pos;
+    }
+
+    // Inserts s before the entry at pos; returns the position after it
+    size_t insert(size_t pos, std::string_view s) {
+        char header[10];
+        size_t n = writeLength(header, s.size());
+        buf_.insert(pos, n + s.size(), '\0');
+        std::memcpy(&buf_[pos], header, n);
+        if (!s.empty()) std::memcpy(&buf_[pos + n], s.data(), s.size());
+        count_++;
+        return pos + n + s.size();
+    }
+
+    void push_back(std::string_view s) { insert(end(), s); }
+
+    // Removes the entry at pos; the following entries move up to pos
+    void erase(size_t pos) {
+        buf_.erase(pos, next(pos) - pos);
+        count_--;
+    }
+
+    void replace(size_t pos, std::string_view s) {
+        erase(pos);
+        insert(pos, s);
+    }
+
+private:
+    std::string buf_;
+    size_t count_ = 0;
+
+    size_t readLength(size_t pos, size_t& len) const {
+        size_t n = 0;
+        len = 0;
+        uint8_t b;
+        do {
+            b = static_cast<uint8_t>(buf_[pos + n]);
+            len |= static_cast<size_t>(b & 0x7F) << (7 * n);
+            n++;
+        } while (b & 0x80);
+        return n;
+    }
+
+    static size_t writeLength(char* out, size_t len) {
+        size_t n = 0;
+        do {
+            uint8_t b = len & 0x7F;
+            len >>= 7;
+            out[n++] = static_cast<char>(len ? b | 0x80 : b);
+        } while (len);
+        return n;
+    }
+};
+
+enum class ValueType : uint8_t { String, Hash, List, Set, ZSet };
+
+// A collection value. KVEntry owns one for every type but String, and
+// bytes() is what the collection charges against the tenant's memory limit.
+class DataObject {
+public:
+    virtual ~DataObject() = default;
+    virtual size_t size() const = 0;
+    virtual size_t bytes() const = 0;
+};
+
+// Field -> value. Listpack of field, value, field, value, ... while small.
+class HashObject : public DataObject {
+public:
+    static const ValueType TYPE = ValueType::Hash;
+
+    size_t size() const override { return table_ ? table_->size() : pack_.size() / 2; }
+
+    // Still in the listpack encoding
+    bool packed() const { return !table_; }
+
+    size_t bytes() const override {
+        size_t total = mallocSize(sizeof(HashObject));
+        if (!table_) return total + pack_.bytes();
+        return total + mallocSize(sizeof(Table)) + table_->tableBytes() + heap_;
+    }
+
+    bool get(std::string_view field, std::string_view& value) const {
+        if (table_) {
+            const Field* slot = table_->find(field, Table::hashOf(field));
+            if (!slot) return false;
+            value = slot->second;
+            return true;
+        }
+        size_t pos = findField(field);
+        if (pos == pack_.end()) return false;
+        value = pack_.at(pack_.next(pos));
+        return true;
+    }
+
+    // Returns whether the field is new
+    bool set(std::string_view field, std::string_view value) {
+        if (!table_ && (field.size() > LISTPACK_MAX_VALUE || value.size() > LISTPACK_MAX_VALUE)) {
+            convert();
+        }
+        if (table_) {
+            size_t hash = Table::hashOf(field);
+            if (Field* slot = table_->find(field, hash)) {
+                heap_ -= stringHeapSize(slot->second.capacity());
+                slot->second.assign(value.data(), value.size());
+                heap_ += stringHeapSize(slot->second.capacity());
+                return false;
+            }
+            Field* slot = table_->insert(Field(std::string(field), std::string(value)), hash);
+            heap_ += stringHeapSize(slot->first.capacity()) + stringHeapSize(slot->second.capacity());
+            return true;
+        }
+
+        size_t pos = findField(field);
+        if (pos != pack_.end()) {
+            pack_.replace(pack_.next(pos), value);
+            return false;
+        }
+        pack_.push_back(field);
+        pack_.push_back(value);
+        if (size() > LISTPACK_MAX_ENTRIES) convert();
+        return true;
+    }
+
+    bool del(std::string_view field) {
+        if (table_) {
+            Field* slot = table_->find(field, Table::hashOf(field));
+            if (!slot) return false;
+            heap_ -= stringHeapSize(slot->first.capacity()) + stringHeapSize(slot->second.capacity());
+            table_->erase(slot);
+            return true;
+        }
+        size_t pos = findField(field);
+        if (pos == pack_.end()) return false;
+        pack_.erase(pos);
+        pack_.erase(pos);
+        return true;
+    }
+
+    // f(field, value) for every field
+    template <typename F>
+    void forEach(F f) const {
+        if (table_) {
+            table_->forEach([&f](const Field& slot) { f(slot.first, slot.second); });
+            return;
+        }
+        for (size_t pos = pack_.begin(); pos != pack_.end();) {
+            size_t value = pack_.next(pos);
+            f(pack_.at(pos), pack_.at(value));
+            pos = pack_.next(value);
+        }
+    }
+
+private:
+    using Field = std::pair<std::string, std::string>;
+    struct FieldKey {
+        std::string_view operator()(const Field& slot) const { return slot.first; }
+    };
+    using Table = SwissTable<Field, FieldKey>;
+
+    Listpack pack_;
+    std::unique_ptr<Table> table_;
+    size_t heap_ = 0;  // string buffers held by table_'s fields and values
+
+    size_t findField(std::string_view field) const {
+        for (size_t pos = pack_.begin(); pos != pack_.end(); pos = pack_.next(pack_.next(pos))) {
+            if (pack_.at(pos) == field) return pos;
+        }
+        return pack_.end();
+    }
+
+    void convert() {
+        std::unique_ptr<Table> table(new Table());
+        forEach([this, &table](std::string_view field, std::string_view value) {
+            Field* slot = table->insert(Field(std::string(field), std::string(value)), Table::hashOf(field));
+            heap_ += stringHeapSize(slot->first.capacity()) + stringHeapSize(slot->second.capacity());
+        });
+        table_ = std::move(table);
+        pack_ = Listpack();
+    }
+};
+
+// Unordered set of strings. Listpack of members while small.
+class SetObject : public DataObject {
+public:
+    static const ValueType TYPE = ValueType::Set;
+
+    size_t size() const override { return table_ ? table_->size() : pack_.size(); }
+
+    bool packed() const { return !table_; }
+
+    size_t bytes() const override {
+        size_t total = mallocSize(sizeof(SetObject));
+        if (!table_) return total + pack_.bytes();
+        return total + mallocSize(sizeof(Table)) + table_->tableBytes() + heap_;
+    }
+
+    bool contains(std::string_view member) const {
+        if (table_) return table_->find(member, Table::hashOf(member)) != nullptr;
+        return findMember(member) != pack_.end();
+    }
+
+    // Returns whether member is new
+    bool add(std::string_view member) {
+        if (!table_ && member.size() > LISTPACK_MAX_VALUE) convert();
+        if (table_) {
+            size_t hash = Table::hashOf(member);
+            if (table_->find(member, hash)) return false;
+            std::string* slot = table_->insert(std::string(member), hash);
+            heap_ += stringHeapSize(slot->capacity());
+            return true;
+        }
+        if (findMember(member) != pack_.end()) return false;
+        pack_.push_back(member);
+        if (pack_.size() > LISTPACK_MAX_ENTRIES) convert();
+        return true;
+    }
+
+    bool remove(std::string_view member) {
+        if (table_) {
+            std::string* slot = table_->find(member, Table::hashOf(member));
+            if (!slot) return false;
+            heap_ -= stringHeapSize(slot->capacity());
+            table_->erase(slot);
+            return true;
+        }
+        size_t pos = findMember(member);
+        if (pos == pack_.end()) return false;
+        pack_.erase(pos);
+        return true;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        if (table_) {
+            table_->forEach([&f](const std::string& member) { f(std::string_view(member)); });
+            return;
+        }
+        for (size_t pos = pack_.begin(); pos != pack_.end(); pos = pack_.next(pos)) {
+            f(pack_.at(pos));
+        }
+    }
+
+private:
+    struct MemberKey {
+        std::string_view operator()(const std::string& member) const { return member; }
+    };
+    using Table = SwissTable<std::string, MemberKey>;
+
+    Listpack pack_;
+    std::unique_ptr<Table> table_;
+    size_t heap_ = 0;  // string buffers held by table_'s members
+
+    size_t findMember(std::string_view member) const {
+        for (size_t pos = pack_.begin(); pos != pack_.end(); pos = pack_.next(pos)) {
+            if (pack_.at(pos) == member) return pos;
+        }
+        return pack_.end();
+    }
+
+    void convert() {
+        std::unique_ptr<Table> table(new Table());
+        forEach([this, &table](std::string_view member) {
+            std::string* slot = table->insert(std::string(member), Table::hashOf(member));
+            heap_ += stringHeapSize(slot->capacity());
+        });
+        table_ = std::move(table);
+        pack_ = Listpack();
+    }
+};
+
+// Sequence with pushes and pops at both ends. Listpack while small, then a
+// deque, whose 512-byte blocks hold 16 strings each.
+class ListObject : public DataObject {
+public:
+    static const ValueType TYPE = ValueType::List;
+
+    size_t size() const override { return items_ ? items_->size() : pack_.size(); }
+
+    bool packed() const { return !items_; }
+
+    size_t bytes() const override {
+        size_t total = mallocSize(sizeof(ListObject));
+        if (!items_) return total + pack_.bytes();
+        size_t blocks = items_->size() / DEQUE_BLOCK_ITEMS + 1;
+        return total + mallocSize(sizeof(Items)) + blocks * mallocSize(512) + heap_;
+    }
+
+    void push(std::string_view value, bool front) {
+        if (!items_ && value.size() > LISTPACK_MAX_VALUE) convert();
+        if (items_) {
+            if (front) {
+                items_->emplace_front(value);
+                heap_ += stringHeapSize(items_->front().capacity());
+            } else {
+                items_->emplace_back(value);
+                heap_ += stringHeapSize(items_->back().capacity());
+            }
+            return;
+        }
+        pack_.insert(front ? pack_.begin() : pack_.end(), value);
+        if (pack_.size() > LISTPACK_MAX_ENTRIES) convert();
+    }
+
+    bool pop(std::string& out, bool front) {
+        if (size() == 0) return false;
+        if (items_) {
+            std::string& item = front ? items_->front() : items_->back();
+            heap_ -= stringHeapSize(item.capacity());
+            out = std::move(item);
+            if (front) {
+                items_->pop_front();
+            } else {
+                items_->pop_back();
+            }
+            return true;
+        }
+        size_t pos = front ? pack_.begin() : pack_.seek(pack_.size() - 1);
+        out.assign(pack_.at(pos));
+        pack_.erase(pos);
+        return true;
+    }
+
+    // f(value) for indexes start..stop, both within the list
+    template <typename F>
+    void range(size_t start, size_t stop, F f) const {
+        if (items_) {
+            for (size_t i = start; i <= stop; ++i) f(std::string_view((*items_)[i]));
+            return;
+        }
+        size_t pos = pack_.seek(start);
+        for (size_t i = start; i <= stop; ++i, pos = pack_.next(pos)) f(pack_.at(pos));
+    }
+
+private:
+    using Items = std::deque<std::string>;
+    static const size_t DEQUE_BLOCK_ITEMS = 512 / sizeof(std::string);
+
+    Listpack pack_;
+    std::unique_ptr<Items> items_;
+    size_t heap_ = 0;  // string buffers held by items_
+
+    void convert() {
+        items_.reset(new Items());
+        for (size_t pos = pack_.begin(); pos != pack_.end(); pos = pack_.next(pos)) {
+            items_->emplace_back(pack_.at(pos));
+            heap_ += stringHeapSize(items_->back().capacity());
+        }
+        pack_ = Listpack();
+    }
+};
+
+// One end of a ZRANGEBYSCORE interval
+struct ScoreBound {
+    double value;
+    bool exclusive;
+
+    bool belowOrAt(double score) const { return exclusive ? value < score : value <= score; }
+    bool aboveOrAt(double score) const { return exclusive ? value > score : value >= score; }
+};
+
+// Members ordered by (score, member). While small, a Listpack of member and
+// score (its 8 raw bytes) pairs kept in that order; then a skiplist for order
+// and rank plus a hash index from member to its skiplist node, as in Redis.
+class ZSetObject : public DataObject {
+public:
+    static const ValueType TYPE = ValueType::ZSet;
+
+    ~ZSetObject() override {
+        if (!list_) return;
+        Node* node = list_->head->levels()[0].forward;
+        while (node) {
+            Node* next = node->levels()[0].forward;
+            freeNode(node);
+            node = next;
+        }
+        freeNode(list_->head);
+    }
+
+    size_t size() const override { return list_ ? list_->length : pack_.size() / 2; }
+
+    bool packed() const { return !list_; }
+
+    size_t bytes() const override {
+        size_t total = mallocSize(sizeof(ZSetObject));
+        if (!list_) return total + pack_.bytes();
+        return total + mallocSize(sizeof(SkipList)) + mallocSize(sizeof(Index)) +
+               list_->index.tableBytes() + heap_;
+    }
+
+    bool score(std::string_view member, double& out) const {
+        if (list_) {
+            Node* const* slot = list_->index.find(member, Index::hashOf(member));
+            if (!slot) return false;
+            out = (*slot)->score;
+            return true;
+        }
+        size_t pos = findMember(member);
+        if (pos == pack_.end()) return false;
+        out = scoreAt(pack_.next(pos));
+        return true;
+    }
+
+    // Adds member at score or moves it there; returns whether it is new
+    bool add(std::string_view member, double score) {
+        if (!list_ && member.size() > LISTPACK_MAX_VALUE) convert();
+        if (list_) {
+            size_t hash = Index::hashOf(member);
+            if (Node** slot = list_->index.find(member, hash)) {
+                Node* old = *slot;
+                if (old->score == score) return false;
+                std::string name = old->member;
+                unlink(old->score, name);
+                *slot = link(score, std::move(name));  // the index itself does not change
+                return false;
+            }
+            list_->index.insert(link(score, std::string(member)), hash);
+            return true;
+        }
+
+        bool added = true;
+        size_t pos = findMember(member);
+        if (pos != pack_.end()) {
+            if (scoreAt(pack_.next(pos)) == score) return false;
+            pack_.erase(pos);
+            pack_.erase(pos);
+            added = false;
+        }
+        pos = pack_.begin();
+        while (pos != pack_.end()) {
+            size_t next = pack_.next(pos);
+            double s = scoreAt(next);
+            if (s > score || (s == score && pack_.at(pos) > member)) break;
+            pos = pack_.next(next);
+        }
+        pos = pack_.insert(pos, member);
+        pack_.insert(pos, std::string_view(reinterpret_cast<const char*>(&score), sizeof(score)));
+        if (size() > LISTPACK_MAX_ENTRIES) convert();
+        return added;
+    }
+
+    bool remove(std::string_view member) {
+        if (list_) {
+            Node** slot = list_->index.find(member, Index::hashOf(member));
+            if (!slot) return false;
+            Node* node = *slot;
+            list_->index.erase(slot);
+            unlink(node->score, node->member);
+            return true;
+        }
+        size_t pos = findMember(member);
+        if (pos == pack_.end()) return false;
+        pack_.erase(pos);
+        pack_.erase(pos);
+        return true;
+    }
+
+    // 0-based position of member in score order
+    bool rank(std::string_view member, size_t& out) const {
+        if (list_) {
+            Node* const* slot = list_->index.find(member, Index::hashOf(member));
+            if (!slot) return false;
+            out = rankOf((*slot)->score, (*slot)->member) - 1;
+            return true;
+        }
+        out = 0;
+        for (size_t pos = pack_.begin(); pos != pack_.end(); pos = pack_.next(pack_.next(pos)), ++out) {
+            if (pack_.at(pos) == member) return true;
+        }
+        return false;
+    }
+
+    // f(member, score) for ranks start..stop, both within the set
+    template <typename F>
+    void range(size_t start, size_t stop, F f) const {
+        if (list_) {
+            Node* node = nodeAt(start + 1);
+            for (size_t i = start; i <= stop; ++i, node = node->levels()[0].forward) {
+                f(std::string_view(node->member), node->score);
+            }
+            return;
+        }
+        size_t pos = pack_.seek(2 * start);
+        for (size_t i = start; i <= stop; ++i) {
+            size_t next = pack_.next(pos);
+            f(pack_.at(pos), scoreAt(next));
+            pos = pack_.next(next);
+        }
+    }
+
+    // f(member, score) in order for scores within [min, max]; stops when f returns false
+    template <typename F>
+    void rangeByScore(const ScoreBound& min, const ScoreBound& max, F f) const {
+        if (list_) {
+            Node* node = list_->head;
+            for (int i = list_->height - 1; i >= 0; --i) {
+                while (node->levels()[i].forward && !min.belowOrAt(node->levels()[i].forward->score)) {
+                    node = node->levels()[i].forward;
+                }
+            }
+            for (node = node->levels()[0].forward; node && max.aboveOrAt(node->score);
+                 node = node->levels()[0].forward) {
+                if (!f(std::string_view(node->member), node->score)) return;
+            }
+            return;
+        }
+        for (size_t pos = pack_.begin(); pos != pack_.end();) {
+            size_t next = pack_.next(pos);
+            double s = scoreAt(next);
+            if (!max.aboveOrAt(s)) return;
+            if (min.belowOrAt(s) && !f(pack_.at(pos), s)) return;
+            pos = pack_.next(next);
+        }
+    }
+
+private:
+    static const int MAX_HEIGHT = 32;
+
+    struct Node {
+        struct Level {
+            Node* forward;
+            size_t span;  // rank distance to forward, for ZRANGE and ZRANK
+        };
+
+        std::string member;
+        double score;
+        Node* backward;
+        int height;
+
+        // The levels follow the node in the same allocation
+        Level* levels() { return reinterpret_cast<Level*>(this + 1); }
+        const Level* levels() const { return reinterpret_cast<const Level*>(this + 1); }
+    };
+
+    struct NodeKey {
+        std::string_view operator()(Node* const& node) const { return node->member; }
+    };
+    using Index = SwissTable<Node*, NodeKey>;
+
+    struct SkipList {
+        Node* head = nullptr;
+        Node* tail = nullptr;
+        size_t length = 0;
+        int height = 1;
+        uint64_t rng = 0x9E3779B97F4A7C15ull;
+        Index index;
+    };
+
+    Listpack pack_;
+    std::unique_ptr<SkipList> list_;
+    size_t heap_ = 0;  // skiplist nodes and their members
+
+    double scoreAt(size_t pos) const {
+        double s;
+        std::memcpy(&s, pack_.at(pos).data(), sizeof(s));
+        return s;
+    }
+
+    size_t findMember(std::string_view member) const {
+        for (size_t pos = pack_.begin(); pos != pack_.end(); pos = pack_.next(pack_.next(pos))) {
+            if (pack_.at(pos) == member) return pos;
+        }
+        return pack_.end();
+    }
+
+    static bool before(const Node* node, double score, std::string_view member) {
+        return node->score < score || (node->score == score && std::string_view(node->member) < member);
+    }
+
+    Node* newNode(int height, double score, std::string&& member) {
+        size_t size = sizeof(Node) + height * sizeof(Node::Level);
+        Node* node = new (::operator new(size)) Node{std::move(member), score, nullptr, height};
+        for (int i = 0; i < height; ++i) node->levels()[i] = {nullptr, 0};
+        heap_ += mallocSize(size) + stringHeapSize(node->member.capacity());
+        return node;
+    }
+
+    void freeNode(Node* node) {
+        heap_ -= mallocSize(sizeof(Node) + node->height * sizeof(Node::Level)) +
+                 stringHeapSize(node->member.capacity());
+        node->~Node();
+        ::operator delete(node);
+    }
+
+    // Height 1 + the number of heads in a row at p = 1/4
+    int randomHeight() {
+        uint64_t& x = list_->rng;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        int height = 1;
+        for (uint64_t bits = x; height < MAX_HEIGHT && (bits & 3) == 0; bits >>= 2) height++;
+        return height;
+    }
+
+    Node* link(double score, std::string&& member) {
+        Node* update[MAX_HEIGHT];
+        size_t rank[MAX_HEIGHT];
+        Node* node = list_->head;
+        for (int i = list_->height - 1; i >= 0; --i) {
+            rank[i] = i == list_->height - 1 ? 0 : rank[i + 1];
+            while (node->levels()[i].forward && before(node->levels()[i].forward, score, member)) {
+                rank[i] += node->levels()[i].span;
+                node = node->levels()[i].forward;
+            }
+            update[i] = node;
+        }
+
+        int height = randomHeight();
+        if (height > list_->height) {
+            for (int i = list_->height; i < height; ++i) {
+                rank[i] = 0;
+                update[i] = list_->head;
+                update[i]->levels()[i].span = list_->length;
+            }
+            list_->height = height;
+        }
+
+        Node* added = newNode(height, score, std::move(member));
+        for (int i = 0; i < height; ++i) {
+            added->levels()[i].forward = update[i]->levels()[i].forward;
+            update[i]->levels()[i].forward = added;
+            added->levels()[i].span = update[i]->levels()[i].span - (rank[0] - rank[i]);
+            update[i]->levels()[i].span = rank[0] - rank[i] + 1;
+        }
+        for (int i = height; i < list_->height; ++i) update[i]->levels()[i].span++;
+
+        added->backward = update[0] == list_->head ? nullptr : update[0];
+        if (added->levels()[0].forward) {
+            added->levels()[0].forward->backward = added;
+        } else {
+            list_->tail = added;
+        }
+        list_->length++;
+        return added;
+    }
+
+    void unlink(double score, std::string_view member) {
+        Node* update[MAX_HEIGHT];
+        Node* node = list_->head;
+        for (int i = list_->height - 1; i >= 0; --i) {
+            while (node->levels()[i].forward && before(node->levels()[i].forward, score, member)) {
+                node = node->levels()[i].forward;
+            }
+            update[i] = node;
+        }
+        node = node->levels()[0].forward;
+
+        for (int i = 0; i < list_->height; ++i) {
+            if (update[i]->levels()[i].forward == node) {
+                update[i]->levels()[i].span += node->levels()[i].span - 1;
+                update[i]->levels()[i].forward = node->levels()[i].forward;
+            } else {
+                update[i]->levels()[i].span--;
+            }
+        }
+        if (node->levels()[0].forward) {
+            node->levels()[0].forward->backward = node->backward;
+        } else {
+            list_->tail = node->backward;
+        }
+        while (list_->height > 1 && !list_->head->levels()[list_->height - 1].forward) list_->height--;
+        list_->length--;
+        freeNode(node);
+    }
+
+    // 1-based rank of an element that is in the list
+    size_t rankOf(double score, std::string_view member) const {
+        size_t rank = 0;
+        const Node* node = list_->head;
+        for (int i = list_->height - 1; i >= 0; --i) {
+            while (node->levels()[i].forward &&
+                   (before(node->levels()[i].forward, score, member) ||
+                    (node->levels()[i].forward->score == score && node->levels()[i].forward->member == member))) {
+                rank += node->levels()[i].span;
+                node = node->levels()[i].forward;
+            }
+            if (node != list_->head && node->score == score && node->member == member) return rank;
+        }
+        return rank;
+    }
+
+    Node* nodeAt(size_t rank) const {
+        size_t traversed = 0;
+        Node* node = list_->head;
+        for (int i = list_->height - 1; i >= 0; --i) {
+            while (node->levels()[i].forward && traversed + node->levels()[i].span <= rank) {
+                traversed += node->levels()[i].span;
+                node = node->levels()[i].forward;
+            }
+            if (traversed == rank) return node;
+        }
+        return nullptr;
+    }
+
+    void convert() {
+        list_.reset(new SkipList());
+        list_->head = newNode(MAX_HEIGHT, 0, std::string());
+        for (size_t pos = pack_.begin(); pos != pack_.end();) {
+            size_t next = pack_.next(pos);
+            std::string_view member = pack_.at(pos);
+            list_->index.insert(link(scoreAt(next), std::string(member)), Index::hashOf(member));
+            pos = pack_.next(next);
+        }
+        pack_ = Listpack();
+    }
+};
@@ -1,13 +1,292 @@
 #include "NodeManager.h"
+#include "RespServer.h"
 #include <iostream>
-#include <sstream>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
 
-RedisNode::RedisNode(const std::string& tenantId, int port, int memoryLimitMb)
+namespace {
+
+// Eviction tuning, same defaults as Redis
+const int EVICTION_SAMPLES = 5;
+const size_t EVICTION_POOL_SIZE = 16;
+const uint8_t LFU_INIT_VAL = 5;
+const double LFU_LOG_FACTOR = 10.0;
+const uint32_t LFU_DECAY_MS = 60 * 1000;
+
+// TTL sweeping: expire at most this many keys per lock hold
+const size_t EXPIRE_BATCH = 128;
+
+// Background rehash: one budgeted step per interval while storage_ grows
+const uint64_t REHASH_INTERVAL_MS = 1;
+
+// KEYS walks the keyspace this many keys per lock hold; SCAN's COUNT default
+const size_t KEYS_BATCH = 1024;
+const size_t SCAN_DEFAULT_COUNT = 10;
+
+uint64_t steadyMs(std::chrono::steady_clock::time_point t) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        t.time_since_epoch()).count());
+}
+
+uint64_t steadyMs() {
+    return steadyMs(std::chrono::steady_clock::now());
+}
+
+uint32_t clockMs() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::string bulkString(std::string_view value) {
+    std::string out = "$" + std::to_string(value.size()) + "\r\n";
+    out.append(value.data(), value.size());
+    out += "\r\n";
+    return out;
+}
+
+const char* const WRONGTYPE = "-WRONGTYPE Operation against a key holding the wrong kind of value\r\n";
+
+// Shortest text that reads back as the same double, as Redis prints scores
+std::string formatScore(double score) {
+    if (std::isinf(score)) {
+        return score > 0 ? "inf" : "-inf";
+    }
+    char buf[32];
+    for (int precision = 15; precision <= 17; ++precision) {
+        std::snprintf(buf, sizeof(buf), "%.*g", precision, score);
+        if (std::strtod(buf, nullptr) == score) {
+            break;
+        }
+    }
+    return buf;
+}
+
+// A whole-string double; "inf", "+inf" and "-inf" included, NaN refused
+bool parseScore(std::string_view s, double& out) {
+    if (s.empty() || s.size() > 64) {
+        return false;
+    }
+    std::string text(s);
+    char* end = nullptr;
+    out = std::strtod(text.c_str(), &end);
+    return end == text.c_str() + text.size() && !std::isnan(out) && !std::isspace(static_cast<unsigned char>(text[0]));
+}
+
+// ZRANGEBYSCORE bound: a score, exclusive with a leading '('
+bool parseScoreBound(std::string_view s, ScoreBound& out) {
+    out.exclusive = !s.empty() && s[0] == '(';
+    return parseScore(out.exclusive ? s.substr(1) : s, out.value);
+}
+
+// Turns Redis start/stop indexes (negative ones count from the end) into
+// positions within a sequence of `size`; false if the range is empty
+bool clampRange(int64_t start, int64_t stop, size_t size, size_t& from, size_t& to) {
+    int64_t n = static_cast<int64_t>(size);
+    if (start < 0) start = std::max<int64_t>(start + n, 0);
+    if (stop < 0) stop += n;
+    if (stop >= n) stop = n - 1;
+    if (start > stop || start >= n) {
+        return false;
+    }
+    from = static_cast<size_t>(start);
+    to = static_cast<size_t>(stop);
+    return true;
+}
+
+// Counter after one decay step per LFU_DECAY_MS idle period
+uint8_t lfuDecayed(const KVEntry& entry, uint32_t now) {
+    uint32_t periods = (now - entry.accessClock) / LFU_DECAY_MS;
+    return periods >= entry.lfuCounter ? 0 : static_cast<uint8_t>(entry.lfuCounter - periods);
+}
+
+// TYPE's answer and SCAN's TYPE filter
+const char* typeName(ValueType type) {
+    switch (type) {
+        case ValueType::String: return "string";
+        case ValueType::Hash: return "hash";
+        case ValueType::List: return "list";
+        case ValueType::Set: return "set";
+        case ValueType::ZSet: return "zset";
+    }
+    return "none";
+}
+
+bool parseTypeName(std::string_view name, ValueType& out) {
+    for (ValueType type : {ValueType::String, ValueType::Hash, ValueType::List, ValueType::Set, ValueType::ZSet}) {
+        if (CommandTable::isKeyword(name, typeName(type))) {
+            out = type;
+            return true;
+        }
+    }
+    return false;
+}
+
+// A pattern without metacharacters names one key (after its escapes)
+bool literalPattern(std::string_view pattern, std::string& key) {
+    key.clear();
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '*' || c == '?' || c == '[') return false;
+        if (c == '\\' && i + 1 < pattern.size()) c = pattern[++i];
+        key += c;
+    }
+    return true;
+}
+
+// Matches the pattern element at p (a byte, '?', an escape or a class)
+// against c and moves p past it
+bool matchElement(std::string_view pattern, size_t& p, char c) {
+    if (pattern[p] == '?') {
+        p++;
+        return true;
+    }
+    if (pattern[p] == '\\' && p + 1 < pattern.size()) {
+        p += 2;
+        return pattern[p - 1] == c;
+    }
+    if (pattern[p] != '[') {
+        return pattern[p++] == c;
+    }
+
+    // A class runs to the next unquoted ']', or to the end of the pattern
+    p++;
+    bool negate = p < pattern.size() && pattern[p] == '^';
+    if (negate) p++;
+    bool hit = false;
+    while (p < pattern.size() && pattern[p] != ']') {
+        if (pattern[p] == '\\' && p + 1 < pattern.size()) {
+            hit |= pattern[p + 1] == c;
+            p += 2;
+        } else if (p + 2 < pattern.size() && pattern[p + 1] == '-' && pattern[p + 2] != ']') {
+            unsigned char lo = pattern[p], hi = pattern[p + 2], uc = c;
+            if (lo > hi) std::swap(lo, hi);
+            hit |= uc >= lo && uc <= hi;
+            p += 3;
+        } else {
+            hit |= pattern[p++] == c;
+        }
+    }
+    if (p < pattern.size()) p++;
+    return hit != negate;
+}
+
+}
+
+// Whitespace-separated arguments of a command line sent over HTTP
+std::vector<std::string_view> splitCommand(const std::string& command) {
+    std::vector<std::string_view> argv;
+    size_t i = 0;
+    while (i < command.size()) {
+        while (i < command.size() && std::isspace(static_cast<unsigned char>(command[i]))) i++;
+        size_t start = i;
+        while (i < command.size() && !std::isspace(static_cast<unsigned char>(command[i]))) i++;
+        if (i > start) argv.emplace_back(command.data() + start, i - start);
+    }
+    return argv;
+}
+
+bool parseInt64(std::string_view s, int64_t& out) {
+    if (s.empty() || s.size() > 20) return false;
+    
+    size_t i = 0;
+    bool negative = s[0] == '-';
+    if (negative && ++i == s.size()) return false;
+    if (s[i] == '0') {
+        // Only "0" itself; "-0" and "007" stay strings
+        if (s.size() != 1) return false;
+        out = 0;
+        return true;
+    }
+    
+    uint64_t v = 0;
+    for (; i < s.size(); ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        uint64_t digit = static_cast<uint64_t>(s[i] - '0');
+        if (v > (UINT64_MAX - digit) / 10) return false;
+        v = v * 10 + digit;
+    }
+    
+    if (negative) {
+        if (v > static_cast<uint64_t>(INT64_MAX) + 1) return false;
+        out = v == static_cast<uint64_t>(INT64_MAX) + 1 ? INT64_MIN : -static_cast<int64_t>(v);
+    } else {
+        if (v > static_cast<uint64_t>(INT64_MAX)) return false;
+        out = static_cast<int64_t>(v);
+    }
+    return true;
+}
+
+// Greedy with one backtrack point: a later '*' supersedes an earlier one, as
+// anything the earlier star could still absorb the later one can too. So a
+// match costs at most pattern x text steps, never the exponential blowup of
+// recursive matching on patterns like "*a*a*a*b".
+bool globMatch(std::string_view pattern, std::string_view text) {
+    size_t p = 0, t = 0;
+    size_t starP = std::string_view::npos, starT = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            starP = ++p;
+            starT = t;
+            continue;
+        }
+        size_t next = p;
+        if (p < pattern.size() && matchElement(pattern, next, text[t])) {
+            p = next;
+            t++;
+            continue;
+        }
+        if (starP == std::string_view::npos) return false;
+        // Let the last star absorb one more byte and retry from there
+        p = starP;
+        t = ++starT;
+    }
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+bool parseEvictionPolicy(const std::string& name, EvictionPolicy& out) {
+    std::string n = name;
+    std::transform(n.begin(), n.end(), n.begin(), ::tolower);
+    
+    if (n == "noeviction") out = EvictionPolicy::NoEviction;
+    else if (n == "allkeys-lru") out = EvictionPolicy::AllKeysLRU;
+    else if (n == "allkeys-lfu") out = EvictionPolicy::AllKeysLFU;
+    else if (n == "volatile-lru") out = EvictionPolicy::VolatileLRU;
+    else if (n == "volatile-ttl") out = EvictionPolicy::VolatileTTL;
+    else return false;
+    return true;
+}
+
+const char* evictionPolicyName(EvictionPolicy policy) {
+    switch (policy) {
+        case EvictionPolicy::NoEviction: return "noeviction";
+        case EvictionPolicy::AllKeysLRU: return "allkeys-lru";
+        case EvictionPolicy::AllKeysLFU: return "allkeys-lfu";
+        case EvictionPolicy::VolatileLRU: return "volatile-lru";
+        case EvictionPolicy::VolatileTTL: return "volatile-ttl";
+    }
+    return "unknown";
+}
+
+
+std::chrono::microseconds RedisNode::rehashBudget_ = KVTable::DEFAULT_REHASH_BUDGET;
+
+void RedisNode::setRehashBudget(std::chrono::microseconds budget) {
+    rehashBudget_ = std::max(budget, std::chrono::microseconds(1));
+}
+
+RedisNode::RedisNode(const std::string& tenantId, int port, int memoryLimitMb, EvictionPolicy policy)
     : tenantId_(tenantId), 
       port_(port),
       memoryLimitBytes_(memoryLimitMb * 1024 * 1024),
-      running_(false) {
+      running_(false),
+      expiryWheel_(steadyMs()),
+      policy_(policy),
+      rng_(std::random_device{}()) {
+    storage_.setRehashBudget(rehashBudget_);
 }
 
 RedisNode::~RedisNode() {
@@ -19,12 +298,35 @@ void RedisNode::start() {
     
     running_ = true;
     sweeperThread_ = std::thread(&RedisNode::ttlSweeperLoop, this);
+    
+    // The listener only holds a weak reference, so it never keeps a removed node alive
+    std::weak_ptr<RedisNode> self = weak_from_this();
+    listenerId_ = RespServer::instance().listen(port_,
+        [self](const std::vector<std::string_view>& argv) -> std::string {
+            auto node = self.lock();
+            if (!node || !node->running_) {
+                return "-ERR node is stopped\r\n";
+            }
+            return node->execute(argv);
+        });
+    if (listenerId_ >= 0) {
+        std::cout << "[RedisNode] " << tenantId_ << " serving RESP on port " << port_ << std::endl;
+    }
 }
 
 void RedisNode::stop() {
     if (!running_) return;
     
-    running_ = false;
+    if (listenerId_ >= 0) {
+        RespServer::instance().close(listenerId_);
+        listenerId_ = -1;
+    }
+    
+    {
+        std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+        running_ = false;
+    }
+    sweeperCv_.notify_all();
     
     if (sweeperThread_.joinable()) {
         sweeperThread_.join();
@@ -32,113 +334,379 @@ void RedisNode::stop() {
 }
 
 void RedisNode::ttlSweeperLoop() {
+    std::unique_lock<std::recursive_mutex> lock(storageMutex_);
+    
     while (running_) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        uint64_t now = steadyMs();
+        bool caughtUp = expiryWheel_.advance(now, EXPIRE_BATCH,
+            [this, now](const std::string& key, uint64_t deadline) {
+                onExpiryDue(key, deadline, now);
+            });
         
-        std::lock_guard<std::mutex> lock(storageMutex_);
-        
-        for (auto it = storage_.begin(); it != storage_.end();) {
-            if (it->second.isExpired()) {
-                it = storage_.erase(it);
-            } else {
-                ++it;
-            }
+        if (!caughtUp) {
+            // More is due: let waiting commands in before the next batch
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+            continue;
         }
+        
+        bool rehashing = storage_.migrating() && storage_.rehashStep();
+        
+        sweeperWakeMs_ = std::min(expiryWheel_.nextDeadline(), now + (rehashing ? REHASH_INTERVAL_MS : 1000));
+        sweeperCv_.wait_until(lock, std::chrono::steady_clock::time_point(
+            std::chrono::milliseconds(sweeperWakeMs_)));
     }
 }
 
-std::string RedisNode::set(const std::string& key, const std::string& value, int ttl) {
-    std::lock_guard<std::mutex> lock(storageMutex_);
+// Files the key's TTL in the wheel unless an earlier wheel entry already
+// covers it (that entry re-files the key when it fires), so refreshing a TTL
+// never adds wheel entries.
+void RedisNode::scheduleExpiry(const std::string& key, KVEntry& entry) {
+    uint64_t deadline = steadyMs(entry.expiry);
+    if (entry.wheelDeadline != 0 && entry.wheelDeadline <= deadline) {
+        return;
+    }
     
-    size_t newSize = key.size() + value.size() + sizeof(KVEntry);
+    expiryWheel_.schedule(key, deadline);
+    entry.wheelDeadline = deadline;
+    if (deadline < sweeperWakeMs_) {
+        sweeperCv_.notify_one();
+    }
+}
+
+void RedisNode::onExpiryDue(const std::string& key, uint64_t deadline, uint64_t nowMs) {
+    KVSlot* slot = storage_.find(key);
+    if (!slot || slot->second.wheelDeadline != deadline) {
+        return;  // key deleted, or this entry was superseded by an earlier one
+    }
     
-    size_t currentMemory = 0;
-    for (const auto& [k, entry] : storage_) {
-        currentMemory += k.size() + entry.value.size() + sizeof(KVEntry);
+    KVEntry& entry = slot->second;
+    entry.wheelDeadline = 0;
+    if (!entry.hasExpiry) {
+        return;  // TTL was removed by an overwrite
+    }
+    
+    if (steadyMs(entry.expiry) <= nowMs) {
+        eraseEntry(slot);
+    } else {
+        scheduleExpiry(key, entry);  // TTL was extended
+    }
+}
+
+size_t RedisNode::entrySize(const std::string& key, const KVEntry& entry) {
+    return stringHeapSize(key.capacity()) + valueSize(entry);
+}
+
+size_t RedisNode::valueSize(const KVEntry& entry) {
+    return entry.type == ValueType::String ? stringHeapSize(entry.value.capacity()) : entry.object()->bytes();
+}
+
+// Table slots are charged per live key rather than per allocated slot: a
+// growing table briefly holds two slot arrays, and a write near the limit must
+// not evict keys to pay for slots that are empty.
+size_t RedisNode::memoryUsageLocked() const {
+    return usedMemory_ + storage_.size() * KVTable::SLOT_BYTES;
+}
+
+KVSlot* RedisNode::storeEntry(const std::string& key, KVEntry&& entry) {
+    size_t hash = KVTable::hashOf(key);
+    KVSlot* slot = storage_.find(key, hash);
+    if (slot) {
+        usedMemory_ -= entrySize(slot->first, slot->second);
+        // An overwrite is an access: keep the key's popularity
+        entry.lfuCounter = slot->second.lfuCounter;
+        entry.accessClock = slot->second.accessClock;
+        entry.wheelDeadline = slot->second.wheelDeadline;
+        slot->second = std::move(entry);
+    } else {
+        entry.lfuCounter = LFU_INIT_VAL;
+        entry.accessClock = clockMs();
+        bool wasMigrating = storage_.migrating();
+        slot = storage_.insert(KVSlot(key, std::move(entry)), hash);
+        if (!wasMigrating && storage_.migrating()) {
+            sweeperCv_.notify_one();  // start background rehash steps
+        }
+    }
+    touch(slot->second);
+    if (slot->second.hasExpiry) {
+        scheduleExpiry(slot->first, slot->second);
+    }
+    usedMemory_ += entrySize(slot->first, slot->second);
+    return slot;
+}
+
+// Records an access: refreshes the LRU clock and bumps the LFU counter with
+// probability 1/((counter - LFU_INIT_VAL) * LFU_LOG_FACTOR + 1) after decay.
+void RedisNode::touch(KVEntry& entry) {
+    uint32_t now = clockMs();
+    uint8_t counter = lfuDecayed(entry, now);
+    if (counter < 255) {
+        double base = counter > LFU_INIT_VAL ? counter - LFU_INIT_VAL : 0;
+        double p = 1.0 / (base * LFU_LOG_FACTOR + 1.0);
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < p) {
+            counter++;
+        }
     }
+    entry.lfuCounter = counter;
+    entry.accessClock = now;
+}
+
+uint64_t RedisNode::evictionScore(const KVEntry& entry, uint32_t now) const {
+    switch (policy_) {
+        case EvictionPolicy::AllKeysLFU:
+            return 255 - lfuDecayed(entry, now);
+        case EvictionPolicy::VolatileTTL:
+            return UINT64_MAX - static_cast<uint64_t>(entry.expiry.time_since_epoch().count());
+        default:
+            return now - entry.accessClock;  // idle time, wraps safely
+    }
+}
+
+// Samples EVICTION_SAMPLES keys from random table slots into the eviction
+// pool, which keeps the best candidates seen across calls (approximate LRU/LFU).
+void RedisNode::sampleEvictionCandidates(const std::string& keep) {
+    bool volatileOnly = policy_ == EvictionPolicy::VolatileLRU || policy_ == EvictionPolicy::VolatileTTL;
+    std::uniform_int_distribution<size_t> pickSlot(0, storage_.slotCount() - 1);
+    uint32_t now = clockMs();
     
-    if ((currentMemory + newSize) > memoryLimitBytes_) {
-        if (!storage_.empty()) {
-            storage_.erase(storage_.begin());
+    int sampled = 0;
+    for (int probes = 0; sampled < EVICTION_SAMPLES && probes < EVICTION_SAMPLES * 64; ++probes) {
+        KVSlot* slot = storage_.slotAt(pickSlot(rng_));
+        if (!slot) continue;
+        if (volatileOnly && !slot->second.hasExpiry) continue;
+        if (slot->first == keep) continue;
+        sampled++;
+        
+        uint64_t score = evictionScore(slot->second, now);
+        if (evictionPool_.size() >= EVICTION_POOL_SIZE && score <= evictionPool_.front().score) continue;
+        
+        bool dup = false;
+        for (const auto& c : evictionPool_) {
+            if (c.key == slot->first) { dup = true; break; }
         }
+        if (dup) continue;
         
-        currentMemory = 0;
-        for (const auto& [k, entry] : storage_) {
-            currentMemory += k.size() + entry.value.size() + sizeof(KVEntry);
+        auto pos = std::lower_bound(evictionPool_.begin(), evictionPool_.end(), score,
+            [](const EvictionCandidate& c, uint64_t s) { return c.score < s; });
+        evictionPool_.insert(pos, EvictionCandidate{score, slot->first});
+        if (evictionPool_.size() > EVICTION_POOL_SIZE) {
+            evictionPool_.erase(evictionPool_.begin());
         }
+    }
+}
+
+// Evicts the best pooled candidate that still exists. Returns false if the
+// policy forbids eviction or nothing eligible is left.
+bool RedisNode::evictOne(const std::string& keep) {
+    if (policy_ == EvictionPolicy::NoEviction || storage_.empty()) {
+        return false;
+    }
+    
+    sampleEvictionCandidates(keep);
+    while (!evictionPool_.empty()) {
+        std::string key = std::move(evictionPool_.back().key);
+        evictionPool_.pop_back();
         
-        if ((currentMemory + newSize) > memoryLimitBytes_) {
+        KVSlot* slot = storage_.find(key);
+        if (!slot || key == keep) continue;
+        eraseEntry(slot);
+        evictedKeys_++;
+        return true;
+    }
+    return false;
+}
+
+void RedisNode::eraseEntry(KVSlot* slot) {
+    usedMemory_ -= entrySize(slot->first, slot->second);
+    storage_.erase(slot);
+}
+
+std::string RedisNode::set(const std::string& key, const std::string& value, long long ttlMs) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    
+    // Net growth if this write lands: a new slot, or just the value's buffer change
+    size_t newSize = stringHeapSize(value.size());
+    KVSlot* existing = storage_.find(key);
+    if (existing) {
+        size_t oldSize = valueSize(existing->second);
+        newSize = newSize > oldSize ? newSize - oldSize : 0;
+    } else {
+        newSize += KVTable::SLOT_BYTES + stringHeapSize(key.size());
+    }
+    
+    // Evict until the write fits or the policy has nothing left to give
+    while ((memoryUsageLocked() + newSize) > memoryLimitBytes_) {
+        if (!evictOne(key)) {
             return "-ERR OOM command not allowed when used memory > 'maxmemory'\r\n";
         }
     }
     
-    if (ttl > 0) {
-        storage_[key] = KVEntry(value, ttl);
+    if (ttlMs > 0) {
+        storeEntry(key, KVEntry(value, std::chrono::milliseconds(ttlMs)));
     } else {
-        storage_[key] = KVEntry(value);
+        storeEntry(key, KVEntry(value));
     }
     
     return "+OK\r\n";
 }
 
-std::string RedisNode::get(const std::string& key) {
-    std::lock_guard<std::mutex> lock(storageMutex_);
+std::string RedisNode::get(std::string_view key) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
     
-    auto it = storage_.find(key);
-    if (it == storage_.end()) {
+    KVSlot* slot = storage_.find(key);
+    if (!slot) {
         return "$-1\r\n";
     }
     
-    if (it->second.isExpired()) {
-        storage_.erase(it);
+    if (slot->second.isExpired()) {
+        eraseEntry(slot);
         return "$-1\r\n";
     }
     
-    const std::string& value = it->second.value;
-    return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    touch(slot->second);
+    const KVEntry& entry = slot->second;
+    if (entry.type != ValueType::String) {
+        return WRONGTYPE;
+    }
+    return entry.isInt ? bulkString(std::to_string(entry.intValue())) : bulkString(entry.value);
 }
 
-std::string RedisNode::del(const std::string& key) {
-    std::lock_guard<std::mutex> lock(storageMutex_);
-    
-    auto count = storage_.erase(key);
-    return ":" + std::to_string(count) + "\r\n";
+// Same path as DEL, so an expired key is not counted
+std::string RedisNode::del(std::string_view key) {
+    return delCommand({"DEL", key});
 }
 
-std::string RedisNode::exists(const std::string& key) {
-    std::lock_guard<std::mutex> lock(storageMutex_);
+std::string RedisNode::exists(std::string_view key) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
     
-    auto it = storage_.find(key);
-    if (it != storage_.end() && !it->second.isExpired()) {
+    KVSlot* slot = storage_.find(key);
+    if (slot && !slot->second.isExpired()) {
+        touch(slot->second);
         return ":1\r\n";
     }
     return ":0\r\n";
 }
 
-std::string RedisNode::keys(const std::string& pattern) {
-    std::lock_guard<std::mutex> lock(storageMutex_);
+std::string RedisNode::incrBy(std::string_view key, int64_t delta) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    
+    KVSlot* slot = storage_.find(key);
+    if (slot && slot->second.isExpired()) {
+        eraseEntry(slot);
+        slot = nullptr;
+    }
+    
+    if (!slot) {
+        std::string name(key);
+        size_t newSize = KVTable::SLOT_BYTES + stringHeapSize(name.size());
+        while ((memoryUsageLocked() + newSize) > memoryLimitBytes_) {
+            if (!evictOne(name)) {
+                return "-ERR OOM command not allowed when used memory > 'maxmemory'\r\n";
+            }
+        }
+        storeEntry(name, KVEntry::integer(delta));
+        return ":" + std::to_string(delta) + "\r\n";
+    }
     
+    KVEntry& entry = slot->second;
+    int64_t current;
+    if (entry.type != ValueType::String) {
+        return WRONGTYPE;
+    }
+    if (entry.isInt) {
+        current = entry.intValue();
+    } else if (!parseInt64(entry.value, current)) {
+        return "-ERR value is not an integer or out of range\r\n";
+    }
+    if ((delta > 0 && current > INT64_MAX - delta) || (delta < 0 && current < INT64_MIN - delta)) {
+        return "-ERR increment or decrement would overflow\r\n";
+    }
+    
+    // In place: the TTL, wheel entry and eviction metadata all stay
+    usedMemory_ -= entrySize(slot->first, entry);
+    entry.setInt(current + delta);
+    usedMemory_ += entrySize(slot->first, entry);
+    touch(entry);
+    return ":" + std::to_string(current + delta) + "\r\n";
+}
+
+// Walks the keyspace KEYS_BATCH keys per lock hold rather than in one go, so
+// KEYS on a big tenant no longer stalls every other client of the node. The
+// reply is built with the lock released.
+std::string RedisNode::keys(const std::string& pattern) {
     std::vector<std::string> matchedKeys;
     
-    for (const auto& [key, entry] : storage_) {
-        if (!entry.isExpired()) {
-            if (pattern == "*") {
-                matchedKeys.push_back(key);
+    std::string key;
+    if (literalPattern(pattern, key)) {
+        std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+        KVSlot* slot = storage_.find(key);
+        if (slot && !slot->second.isExpired()) {
+            matchedKeys.push_back(std::move(key));
+        }
+    } else {
+        // Writes between batches can resize storage_, and a walk across a
+        // shrink may see a key twice (see SwissTable::scan)
+        bool resized = false;
+        size_t slots = 0;
+        size_t cursor = 0;
+        while (true) {
+            {
+                std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+                if (storage_.migrating() || (cursor != 0 && storage_.slotCount() != slots)) {
+                    resized = true;
+                }
+                slots = storage_.slotCount();
+                cursor = scanKeys(cursor, KEYS_BATCH, pattern, nullptr, matchedKeys);
             }
+            if (cursor == 0) {
+                break;
+            }
+            // Let waiting commands in before the next batch
+            std::this_thread::yield();
+        }
+        
+        if (resized) {
+            std::sort(matchedKeys.begin(), matchedKeys.end());
+            matchedKeys.erase(std::unique(matchedKeys.begin(), matchedKeys.end()), matchedKeys.end());
         }
     }
     
     std::string result = "*" + std::to_string(matchedKeys.size()) + "\r\n";
     for (const auto& key : matchedKeys) {
-        result += "$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+        result += bulkString(key);
     }
     
     return result;
 }
 
+size_t RedisNode::scanKeys(size_t cursor, size_t count, std::string_view pattern,
+                           const ValueType* type, std::vector<std::string>& out) {
+    bool all = pattern == "*";
+    // Like Redis, a sparse table still ends the call after count * 10 groups
+    size_t maxGroups = count > SIZE_MAX / 10 ? SIZE_MAX : count * 10;
+    size_t visited = 0;
+    size_t groups = 0;
+    do {
+        cursor = storage_.scan(cursor, [&](const KVSlot& slot) {
+            visited++;
+            const KVEntry& entry = slot.second;
+            if (entry.isExpired() || (type && entry.type != *type)) {
+                return;
+            }
+            if (all || globMatch(pattern, slot.first)) {
+                out.push_back(slot.first);
+            }
+        });
+    } while (cursor != 0 && visited < count && ++groups < maxGroups);
+    return cursor;
+}
+
 std::string RedisNode::flushall() {
-    std::lock_guard<std::mutex> lock(storageMutex_);
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
     storage_.clear();
+    expiryWheel_.clear();
+    usedMemory_ = 0;
     return "+OK\r\n";
 }
 
@@ -146,18 +714,782 @@ std::string RedisNode::ping() {
     return "+PONG\r\n";
 }
 
-size_t RedisNode::getMemoryUsage() const {
-    std::lock_guard<std::mutex> lock(storageMutex_);
+std::string RedisNode::info() {
+    std::string info = "# Memory\r\n";
+    info += "used_memory:" + std::to_string(getMemoryUsage()) + "\r\n";
+    info += "used_memory_human:" + std::to_string(getMemoryUsage() / 1024) + "K\r\n";
+    info += "maxmemory:" + std::to_string(memoryLimitBytes_) + "\r\n";
+    info += "maxmemory_policy:" + std::string(evictionPolicyName(getEvictionPolicy())) + "\r\n";
+    info += "evicted_keys:" + std::to_string(getEvictedKeys()) + "\r\n";
+    info += "# Keyspace\r\n";
+    info += "db0:keys=" + std::to_string(getKeyCount()) + "\r\n";
+    return bulkString(info);
+}
+
+const std::array<RedisNode::CommandHandler, CMD_COUNT> RedisNode::commandHandlers_ = [] {
+    std::array<CommandHandler, CMD_COUNT> h{};
+    h[CMD_SET] = &RedisNode::setCommand;
+    h[CMD_GET] = &RedisNode::getCommand;
+    h[CMD_DEL] = &RedisNode::delCommand;
+    h[CMD_EXISTS] = &RedisNode::existsCommand;
+    h[CMD_INCR] = &RedisNode::incrCommand;
+    h[CMD_DECR] = &RedisNode::decrCommand;
+    h[CMD_INCRBY] = &RedisNode::incrbyCommand;
+    h[CMD_DECRBY] = &RedisNode::decrbyCommand;
+    h[CMD_KEYS] = &RedisNode::keysCommand;
+    h[CMD_SCAN] = &RedisNode::scanCommand;
+    h[CMD_FLUSHALL] = &RedisNode::flushallCommand;
+    h[CMD_PING] = &RedisNode::pingCommand;
+    h[CMD_INFO] = &RedisNode::infoCommand;
+    h[CMD_COMMAND] = &RedisNode::commandCommand;
+    h[CMD_TYPE] = &RedisNode::typeCommand;
+    h[CMD_HSET] = &RedisNode::hsetCommand;
+    h[CMD_HGET] = &RedisNode::hgetCommand;
+    h[CMD_HDEL] = &RedisNode::hdelCommand;
+    h[CMD_HGETALL] = &RedisNode::hgetallCommand;
+    h[CMD_HLEN] = &RedisNode::hlenCommand;
+    h[CMD_HEXISTS] = &RedisNode::hexistsCommand;
+    h[CMD_HINCRBY] = &RedisNode::hincrbyCommand;
+    h[CMD_LPUSH] = &RedisNode::lpushCommand;
+    h[CMD_RPUSH] = &RedisNode::rpushCommand;
+    h[CMD_LPOP] = &RedisNode::lpopCommand;
+    h[CMD_RPOP] = &RedisNode::rpopCommand;
+    h[CMD_LLEN] = &RedisNode::llenCommand;
+    h[CMD_LRANGE] = &RedisNode::lrangeCommand;
+    h[CMD_LINDEX] = &RedisNode::lindexCommand;
+    h[CMD_SADD] = &RedisNode::saddCommand;
+    h[CMD_SREM] = &RedisNode::sremCommand;
+    h[CMD_SISMEMBER] = &RedisNode::sismemberCommand;
+    h[CMD_SMEMBERS] = &RedisNode::smembersCommand;
+    h[CMD_SCARD] = &RedisNode::scardCommand;
+    h[CMD_ZADD] = &RedisNode::zaddCommand;
+    h[CMD_ZREM] = &RedisNode::zremCommand;
+    h[CMD_ZSCORE] = &RedisNode::zscoreCommand;
+    h[CMD_ZCARD] = &RedisNode::zcardCommand;
+    h[CMD_ZRANK] = &RedisNode::zrankCommand;
+    h[CMD_ZRANGE] = &RedisNode::zrangeCommand;
+    h[CMD_ZRANGEBYSCORE] = &RedisNode::zrangebyscoreCommand;
+    return h;
+}();
+
+std::string RedisNode::execute(const std::vector<std::string_view>& argv) {
+    if (argv.empty()) {
+        return "-ERR empty command\r\n";
+    }
     
-    size_t total = 0;
-    for (const auto& [key, entry] : storage_) {
-        total += key.size() + entry.value.size() + sizeof(KVEntry);
+    const CommandSpec* spec = CommandTable::find(argv[0]);
+    if (!spec || !commandHandlers_[spec->id]) {
+        return "-ERR unknown command '" + std::string(argv[0]) + "'\r\n";
+    }
+    if (!spec->arityOk(argv.size())) {
+        return CommandTable::arityError(*spec);
+    }
+    return (this->*commandHandlers_[spec->id])(argv);
+}
+
+std::string RedisNode::setCommand(const std::vector<std::string_view>& argv) {
+    // Largest TTL whose expiry still fits steady_clock (nanoseconds) after
+    // being added to now()
+    static const int64_t kMaxTtlMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration::max()).count() / 2;
+
+    long long ttlMs = 0;
+    for (size_t i = 3; i < argv.size(); i += 2) {
+        std::string flag(argv[i]);
+        std::transform(flag.begin(), flag.end(), flag.begin(), ::toupper);
+        // Only a single EX or PX is supported; NX, XX, KEEPTTL and anything
+        // else would change what SET does, so refuse rather than ignore them
+        if ((flag != "EX" && flag != "PX") || ttlMs != 0 || i + 1 >= argv.size()) {
+            return "-ERR syntax error\r\n";
+        }
+        int64_t amount = 0;
+        if (!parseInt64(argv[i + 1], amount) || amount <= 0) {
+            return "-ERR invalid expire time in 'set' command\r\n";
+        }
+        if (flag == "EX") {
+            if (amount > kMaxTtlMs / 1000) return "-ERR invalid expire time in 'set' command\r\n";
+            amount *= 1000;
+        } else if (amount > kMaxTtlMs) {
+            return "-ERR invalid expire time in 'set' command\r\n";
+        }
+        ttlMs = amount;
+    }
+    return set(std::string(argv[1]), std::string(argv[2]), ttlMs);
+}
+
+std::string RedisNode::getCommand(const std::vector<std::string_view>& argv) {
+    return get(argv[1]);
+}
+
+std::string RedisNode::delCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    long long deleted = 0;
+    for (size_t i = 1; i < argv.size(); ++i) {
+        if (KVSlot* slot = storage_.find(argv[i])) {
+            // An expired key the sweeper has not reached yet is already gone
+            // as far as clients can tell; drop it without counting it
+            if (!slot->second.isExpired()) deleted++;
+            eraseEntry(slot);
+        }
+    }
+    return ":" + std::to_string(deleted) + "\r\n";
+}
+
+std::string RedisNode::existsCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    long long found = 0;
+    for (size_t i = 1; i < argv.size(); ++i) {
+        KVSlot* slot = storage_.find(argv[i]);
+        if (slot && !slot->second.isExpired()) {
+            touch(slot->second);
+            found++;
+        }
     }
-    return total;
+    return ":" + std::to_string(found) + "\r\n";
+}
+
+std::string RedisNode::incrCommand(const std::vector<std::string_view>& argv) {
+    return incrBy(argv[1], 1);
+}
+
+std::string RedisNode::decrCommand(const std::vector<std::string_view>& argv) {
+    return incrBy(argv[1], -1);
+}
+
+std::string RedisNode::incrbyCommand(const std::vector<std::string_view>& argv) {
+    int64_t amount;
+    if (!parseInt64(argv[2], amount)) {
+        return "-ERR value is not an integer or out of range\r\n";
+    }
+    return incrBy(argv[1], amount);
+}
+
+std::string RedisNode::decrbyCommand(const std::vector<std::string_view>& argv) {
+    int64_t amount;
+    if (!parseInt64(argv[2], amount)) {
+        return "-ERR value is not an integer or out of range\r\n";
+    }
+    if (amount == INT64_MIN) {
+        return "-ERR decrement would overflow\r\n";
+    }
+    return incrBy(argv[1], -amount);
+}
+
+std::string RedisNode::keysCommand(const std::vector<std::string_view>& argv) {
+    return keys(std::string(argv[1]));
+}
+
+// SCAN cursor [MATCH pattern] [COUNT count] [TYPE type]: one short lock hold
+// per call. The cursor is all the state there is, so a client may drop it
+// or come back to it much later.
+std::string RedisNode::scanCommand(const std::vector<std::string_view>& argv) {
+    std::string_view text = argv[1];
+    size_t cursor = 0;
+    if (text.empty() || text.size() > 20) {
+        return "-ERR invalid cursor\r\n";
+    }
+    for (char c : text) {
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (c < '0' || c > '9' || cursor > (UINT64_MAX - digit) / 10) {
+            return "-ERR invalid cursor\r\n";
+        }
+        cursor = cursor * 10 + digit;
+    }
+    
+    std::string_view pattern = "*";
+    size_t count = SCAN_DEFAULT_COUNT;
+    ValueType type;
+    bool typed = false;
+    for (size_t i = 2; i < argv.size(); i += 2) {
+        if (i + 1 == argv.size()) {
+            return "-ERR syntax error\r\n";
+        }
+        if (CommandTable::isKeyword(argv[i], "match")) {
+            pattern = argv[i + 1];
+        } else if (CommandTable::isKeyword(argv[i], "count")) {
+            int64_t n;
+            if (!parseInt64(argv[i + 1], n)) {
+                return "-ERR value is not an integer or out of range\r\n";
+            }
+            if (n < 1) {
+                return "-ERR syntax error\r\n";
+            }
+            count = static_cast<size_t>(n);
+        } else if (CommandTable::isKeyword(argv[i], "type")) {
+            if (!parseTypeName(argv[i + 1], type)) {
+                return "-ERR unknown type name '" + std::string(argv[i + 1]) + "'\r\n";
+            }
+            typed = true;
+        } else {
+            return "-ERR syntax error\r\n";
+        }
+    }
+    
+    std::vector<std::string> found;
+    {
+        std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+        cursor = scanKeys(cursor, count, pattern, typed ? &type : nullptr, found);
+    }
+    
+    std::string result = "*2\r\n" + bulkString(std::to_string(cursor));
+    result += "*" + std::to_string(found.size()) + "\r\n";
+    for (const auto& key : found) {
+        result += bulkString(key);
+    }
+    return result;
+}
+
+std::string RedisNode::flushallCommand(const std::vector<std::string_view>&) {
+    return flushall();
+}
+
+std::string RedisNode::pingCommand(const std::vector<std::string_view>&) {
+    return ping();
+}
+
+std::string RedisNode::infoCommand(const std::vector<std::string_view>&) {
+    return info();
+}
+
+std::string RedisNode::commandCommand(const std::vector<std::string_view>& argv) {
+    return CommandTable::reply(argv, [](CommandId id) { return commandHandlers_[id] != nullptr; });
+}
+
+// Collections. Every write takes the entry's memory off usedMemory_ before it
+// changes the collection and puts it back through finishWrite(), so a
+// collection is charged exactly what DataObject::bytes() says.
+
+KVSlot* RedisNode::readSlot(std::string_view key, ValueType type, std::string& error) {
+    KVSlot* slot = storage_.find(key);
+    if (slot && slot->second.isExpired()) {
+        eraseEntry(slot);
+        return nullptr;
+    }
+    if (slot && slot->second.type != type) {
+        error = WRONGTYPE;
+        return nullptr;
+    }
+    if (slot) {
+        touch(slot->second);
+    }
+    return slot;
+}
+
+KVSlot* RedisNode::writeSlot(std::string_view key, ValueType type, size_t growth, std::string& error) {
+    std::string name(key);
+    KVSlot* slot = storage_.find(key);
+    if (!slot || slot->second.isExpired()) {
+        // A new key: its slot, its name and at most the largest empty collection
+        growth += KVTable::SLOT_BYTES + stringHeapSize(name.size()) + mallocSize(sizeof(ZSetObject));
+    } else if (slot->second.type != type) {
+        error = WRONGTYPE;
+        return nullptr;
+    }
+    
+    // Evicting or expiring keys may move slots, so look the key up again after
+    while ((memoryUsageLocked() + growth) > memoryLimitBytes_) {
+        if (!evictOne(name)) {
+            error = "-ERR OOM command not allowed when used memory > 'maxmemory'\r\n";
+            return nullptr;
+        }
+    }
+    
+    slot = readSlot(key, type, error);
+    if (!slot) {
+        slot = storeEntry(name, KVEntry::collection(type));
+    }
+    usedMemory_ -= entrySize(slot->first, slot->second);
+    return slot;
+}
+
+void RedisNode::finishWrite(KVSlot* slot) {
+    usedMemory_ += entrySize(slot->first, slot->second);
+    if (slot->second.object()->size() == 0) {
+        eraseEntry(slot);
+    }
+}
+
+std::string RedisNode::typeCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    KVSlot* slot = storage_.find(argv[1]);
+    if (!slot || slot->second.isExpired()) {
+        return "+none\r\n";
+    }
+    return "+" + std::string(typeName(slot->second.type)) + "\r\n";
+}
+
+std::string RedisNode::hsetCommand(const std::vector<std::string_view>& argv) {
+    if (argv.size() % 2 != 0) {
+        return CommandTable::arityError(COMMAND_SPECS[CMD_HSET]);
+    }
+    size_t growth = 0;
+    for (size_t i = 2; i < argv.size(); ++i) {
+        growth += argv[i].size() + 2;
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = writeSlot(argv[1], ValueType::Hash, growth, error);
+    if (!slot) {
+        return error;
+    }
+    HashObject* hash = slot->second.as<HashObject>();
+    long long added = 0;
+    for (size_t i = 2; i < argv.size(); i += 2) {
+        added += hash->set(argv[i], argv[i + 1]) ? 1 : 0;
+    }
+    finishWrite(slot);
+    return ":" + std::to_string(added) + "\r\n";
+}
+
+std::string RedisNode::hgetCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Hash, error);
+    std::string_view value;
+    if (!slot) {
+        return error.empty() ? "$-1\r\n" : error;
+    }
+    return slot->second.as<HashObject>()->get(argv[2], value) ? bulkString(value) : "$-1\r\n";
+}
+
+std::string RedisNode::hdelCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Hash, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    usedMemory_ -= entrySize(slot->first, slot->second);
+    HashObject* hash = slot->second.as<HashObject>();
+    long long removed = 0;
+    for (size_t i = 2; i < argv.size(); ++i) {
+        removed += hash->del(argv[i]) ? 1 : 0;
+    }
+    finishWrite(slot);
+    return ":" + std::to_string(removed) + "\r\n";
+}
+
+std::string RedisNode::hgetallCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Hash, error);
+    if (!slot) {
+        return error.empty() ? "*0\r\n" : error;
+    }
+    const HashObject* hash = slot->second.as<HashObject>();
+    std::string out = "*" + std::to_string(hash->size() * 2) + "\r\n";
+    hash->forEach([&out](std::string_view field, std::string_view value) {
+        out += bulkString(field);
+        out += bulkString(value);
+    });
+    return out;
+}
+
+std::string RedisNode::hlenCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Hash, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    return ":" + std::to_string(slot->second.object()->size()) + "\r\n";
+}
+
+std::string RedisNode::hexistsCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Hash, error);
+    std::string_view value;
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    return slot->second.as<HashObject>()->get(argv[2], value) ? ":1\r\n" : ":0\r\n";
+}
+
+std::string RedisNode::hincrbyCommand(const std::vector<std::string_view>& argv) {
+    int64_t delta;
+    if (!parseInt64(argv[3], delta)) {
+        return "-ERR value is not an integer or out of range\r\n";
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = writeSlot(argv[1], ValueType::Hash, argv[2].size() + 24, error);
+    if (!slot) {
+        return error;
+    }
+    HashObject* hash = slot->second.as<HashObject>();
+    std::string_view text;
+    int64_t current = 0;
+    if (hash->get(argv[2], text) && !parseInt64(text, current)) {
+        error = "-ERR hash value is not an integer\r\n";
+    } else if ((delta > 0 && current > INT64_MAX - delta) || (delta < 0 && current < INT64_MIN - delta)) {
+        error = "-ERR increment or decrement would overflow\r\n";
+    } else {
+        hash->set(argv[2], std::to_string(current + delta));
+    }
+    finishWrite(slot);
+    return error.empty() ? ":" + std::to_string(current + delta) + "\r\n" : error;
+}
+
+std::string RedisNode::pushCommand(const std::vector<std::string_view>& argv, bool front) {
+    size_t growth = 0;
+    for (size_t i = 2; i < argv.size(); ++i) {
+        growth += argv[i].size() + 2;
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = writeSlot(argv[1], ValueType::List, growth, error);
+    if (!slot) {
+        return error;
+    }
+    ListObject* list = slot->second.as<ListObject>();
+    for (size_t i = 2; i < argv.size(); ++i) {
+        list->push(argv[i], front);
+    }
+    size_t length = list->size();
+    finishWrite(slot);
+    return ":" + std::to_string(length) + "\r\n";
+}
+
+std::string RedisNode::popCommand(const std::vector<std::string_view>& argv, bool front) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::List, error);
+    if (!slot) {
+        return error.empty() ? "$-1\r\n" : error;
+    }
+    usedMemory_ -= entrySize(slot->first, slot->second);
+    std::string value;
+    slot->second.as<ListObject>()->pop(value, front);
+    finishWrite(slot);
+    return bulkString(value);
+}
+
+std::string RedisNode::lpushCommand(const std::vector<std::string_view>& argv) {
+    return pushCommand(argv, true);
+}
+
+std::string RedisNode::rpushCommand(const std::vector<std::string_view>& argv) {
+    return pushCommand(argv, false);
+}
+
+std::string RedisNode::lpopCommand(const std::vector<std::string_view>& argv) {
+    return popCommand(argv, true);
+}
+
+std::string RedisNode::rpopCommand(const std::vector<std::string_view>& argv) {
+    return popCommand(argv, false);
+}
+
+std::string RedisNode::llenCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::List, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    return ":" + std::to_string(slot->second.object()->size()) + "\r\n";
+}
+
+std::string RedisNode::lrangeCommand(const std::vector<std::string_view>& argv) {
+    int64_t start, stop;
+    if (!parseInt64(argv[2], start) || !parseInt64(argv[3], stop)) {
+        return "-ERR value is not an integer or out of range\r\n";
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::List, error);
+    if (!slot) {
+        return error.empty() ? "*0\r\n" : error;
+    }
+    const ListObject* list = slot->second.as<ListObject>();
+    size_t from, to;
+    if (!clampRange(start, stop, list->size(), from, to)) {
+        return "*0\r\n";
+    }
+    std::string out = "*" + std::to_string(to - from + 1) + "\r\n";
+    list->range(from, to, [&out](std::string_view value) { out += bulkString(value); });
+    return out;
+}
+
+std::string RedisNode::lindexCommand(const std::vector<std::string_view>& argv) {
+    int64_t index;
+    if (!parseInt64(argv[2], index)) {
+        return "-ERR value is not an integer or out of range\r\n";
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::List, error);
+    if (!slot) {
+        return error.empty() ? "$-1\r\n" : error;
+    }
+    const ListObject* list = slot->second.as<ListObject>();
+    int64_t size = static_cast<int64_t>(list->size());
+    if (index < 0) {
+        index += size;
+    }
+    if (index < 0 || index >= size) {
+        return "$-1\r\n";
+    }
+    std::string out;
+    list->range(index, index, [&out](std::string_view value) { out = bulkString(value); });
+    return out;
+}
+
+std::string RedisNode::saddCommand(const std::vector<std::string_view>& argv) {
+    size_t growth = 0;
+    for (size_t i = 2; i < argv.size(); ++i) {
+        growth += argv[i].size() + 2;
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = writeSlot(argv[1], ValueType::Set, growth, error);
+    if (!slot) {
+        return error;
+    }
+    SetObject* set = slot->second.as<SetObject>();
+    long long added = 0;
+    for (size_t i = 2; i < argv.size(); ++i) {
+        added += set->add(argv[i]) ? 1 : 0;
+    }
+    finishWrite(slot);
+    return ":" + std::to_string(added) + "\r\n";
+}
+
+std::string RedisNode::sremCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Set, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    usedMemory_ -= entrySize(slot->first, slot->second);
+    SetObject* set = slot->second.as<SetObject>();
+    long long removed = 0;
+    for (size_t i = 2; i < argv.size(); ++i) {
+        removed += set->remove(argv[i]) ? 1 : 0;
+    }
+    finishWrite(slot);
+    return ":" + std::to_string(removed) + "\r\n";
+}
+
+std::string RedisNode::sismemberCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Set, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    return slot->second.as<SetObject>()->contains(argv[2]) ? ":1\r\n" : ":0\r\n";
+}
+
+std::string RedisNode::smembersCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Set, error);
+    if (!slot) {
+        return error.empty() ? "*0\r\n" : error;
+    }
+    const SetObject* set = slot->second.as<SetObject>();
+    std::string out = "*" + std::to_string(set->size()) + "\r\n";
+    set->forEach([&out](std::string_view member) { out += bulkString(member); });
+    return out;
+}
+
+std::string RedisNode::scardCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::Set, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    return ":" + std::to_string(slot->second.object()->size()) + "\r\n";
+}
+
+std::string RedisNode::zaddCommand(const std::vector<std::string_view>& argv) {
+    if (argv.size() % 2 != 0) {
+        return "-ERR syntax error\r\n";
+    }
+    // Every score is checked before anything changes
+    std::vector<double> scores;
+    size_t growth = 0;
+    for (size_t i = 2; i < argv.size(); i += 2) {
+        double score;
+        if (!parseScore(argv[i], score)) {
+            return "-ERR value is not a valid float\r\n";
+        }
+        scores.push_back(score);
+        growth += argv[i + 1].size() + 16;
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = writeSlot(argv[1], ValueType::ZSet, growth, error);
+    if (!slot) {
+        return error;
+    }
+    ZSetObject* zset = slot->second.as<ZSetObject>();
+    long long added = 0;
+    for (size_t i = 2; i < argv.size(); i += 2) {
+        added += zset->add(argv[i + 1], scores[(i - 2) / 2]) ? 1 : 0;
+    }
+    finishWrite(slot);
+    return ":" + std::to_string(added) + "\r\n";
+}
+
+std::string RedisNode::zremCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::ZSet, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    usedMemory_ -= entrySize(slot->first, slot->second);
+    ZSetObject* zset = slot->second.as<ZSetObject>();
+    long long removed = 0;
+    for (size_t i = 2; i < argv.size(); ++i) {
+        removed += zset->remove(argv[i]) ? 1 : 0;
+    }
+    finishWrite(slot);
+    return ":" + std::to_string(removed) + "\r\n";
+}
+
+std::string RedisNode::zscoreCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::ZSet, error);
+    double score;
+    if (!slot) {
+        return error.empty() ? "$-1\r\n" : error;
+    }
+    return slot->second.as<ZSetObject>()->score(argv[2], score) ? bulkString(formatScore(score)) : "$-1\r\n";
+}
+
+std::string RedisNode::zcardCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::ZSet, error);
+    if (!slot) {
+        return error.empty() ? ":0\r\n" : error;
+    }
+    return ":" + std::to_string(slot->second.object()->size()) + "\r\n";
+}
+
+std::string RedisNode::zrankCommand(const std::vector<std::string_view>& argv) {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::ZSet, error);
+    size_t rank;
+    if (!slot) {
+        return error.empty() ? "$-1\r\n" : error;
+    }
+    return slot->second.as<ZSetObject>()->rank(argv[2], rank) ? ":" + std::to_string(rank) + "\r\n" : "$-1\r\n";
+}
+
+std::string RedisNode::zrangeCommand(const std::vector<std::string_view>& argv) {
+    int64_t start, stop;
+    if (!parseInt64(argv[2], start) || !parseInt64(argv[3], stop)) {
+        return "-ERR value is not an integer or out of range\r\n";
+    }
+    bool withScores = argv.size() == 5 && CommandTable::isKeyword(argv[4], "withscores");
+    if (argv.size() > 4 && !withScores) {
+        return "-ERR syntax error\r\n";
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::ZSet, error);
+    if (!slot) {
+        return error.empty() ? "*0\r\n" : error;
+    }
+    const ZSetObject* zset = slot->second.as<ZSetObject>();
+    size_t from, to;
+    if (!clampRange(start, stop, zset->size(), from, to)) {
+        return "*0\r\n";
+    }
+    std::string out = "*" + std::to_string((to - from + 1) * (withScores ? 2 : 1)) + "\r\n";
+    zset->range(from, to, [&](std::string_view member, double score) {
+        out += bulkString(member);
+        if (withScores) {
+            out += bulkString(formatScore(score));
+        }
+    });
+    return out;
+}
+
+std::string RedisNode::zrangebyscoreCommand(const std::vector<std::string_view>& argv) {
+    ScoreBound min, max;
+    if (!parseScoreBound(argv[2], min) || !parseScoreBound(argv[3], max)) {
+        return "-ERR min or max is not a float\r\n";
+    }
+    bool withScores = false;
+    int64_t offset = 0, count = -1;
+    for (size_t i = 4; i < argv.size(); ++i) {
+        if (CommandTable::isKeyword(argv[i], "withscores")) {
+            withScores = true;
+        } else if (CommandTable::isKeyword(argv[i], "limit") && i + 2 < argv.size()) {
+            if (!parseInt64(argv[i + 1], offset) || !parseInt64(argv[i + 2], count)) {
+                return "-ERR value is not an integer or out of range\r\n";
+            }
+            i += 2;
+        } else {
+            return "-ERR syntax error\r\n";
+        }
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    std::string error;
+    KVSlot* slot = readSlot(argv[1], ValueType::ZSet, error);
+    if (!slot) {
+        return error.empty() ? "*0\r\n" : error;
+    }
+    if (offset < 0) {
+        return "*0\r\n";
+    }
+    std::string body;
+    size_t items = 0;
+    slot->second.as<ZSetObject>()->rangeByScore(min, max, [&](std::string_view member, double score) {
+        if (offset > 0) {
+            offset--;
+            return true;
+        }
+        if (count == 0) {
+            return false;
+        }
+        body += bulkString(member);
+        items++;
+        if (withScores) {
+            body += bulkString(formatScore(score));
+            items++;
+        }
+        if (count > 0) {
+            count--;
+        }
+        return true;
+    });
+    return "*" + std::to_string(items) + "\r\n" + body;
+}
+
+size_t RedisNode::getMemoryUsage() const {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    return memoryUsageLocked();
+}
+
+size_t RedisNode::recountMemory() const {
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
+    size_t total = 0;
+    storage_.forEach([&total](const KVSlot& slot) { total += entrySize(slot.first, slot.second); });
+    return total + storage_.size() * KVTable::SLOT_BYTES;
 }
 
 size_t RedisNode::getKeyCount() const {
-    std::lock_guard<std::mutex> lock(storageMutex_);
+    std::lock_guard<std::recursive_mutex> lock(storageMutex_);
     return storage_.size();
 }
 
@@ -167,14 +1499,14 @@ NodeManager::~NodeManager() {
     stopAllNodes();
 }
 
-bool NodeManager::startNode(const std::string& tenantId, int port, int memoryLimitMb) {
+bool NodeManager::startNode(const std::string& tenantId, int port, int memoryLimitMb, EvictionPolicy policy) {
     std::lock_guard<std::mutex> lock(nodesMutex_);
     
     if (nodes_.find(tenantId) != nodes_.end()) {
         return true;
     }
     
-    auto node = std::make_shared<RedisNode>(tenantId, port, memoryLimitMb);
+    auto node = std::make_shared<RedisNode>(tenantId, port, memoryLimitMb, policy);
     node->start();
     
     nodes_[tenantId] = node;
@@ -220,187 +1552,28 @@ std::string NodeManager::executeCommand(const std::string& tenantId, const std::
         return "-ERR tenant not found\r\n";
     }
     
-    std::istringstream iss(command);
-    std::string cmd;
-    iss >> cmd;
+    return node->execute(splitCommand(command));
+}
+
+std::vector<std::string> NodeManager::executeBatch(const std::string& tenantId,
+                                                   const std::vector<std::string>& commands,
+                                                   bool atomic) {
+    std::shared_ptr<RedisNode> node = getNode(tenantId);
+    if (!node) {
+        return std::vector<std::string>(commands.size(), "-ERR tenant not found\r\n");
+    }
     
-    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+    std::vector<std::string> replies;
+    replies.reserve(commands.size());
     
-    if (cmd == "SET") {
-        std::string key, value;
-        int ttl = 0;
-        iss >> key >> value;
-        
-        std::string ttlFlag;
-        if (iss >> ttlFlag) {
-            std::transform(ttlFlag.begin(), ttlFlag.end(), ttlFlag.begin(), ::toupper);
-            if (ttlFlag == "EX") {
-                iss >> ttl;
-            }
-        }
-        
-        return node->set(key, value, ttl);
-        
-    } else if (cmd == "GET") {
-        std::string key;
-        iss >> key;
-        return node->get(key);
-        
-    } else if (cmd == "DEL") {
-        std::string key;
-        iss >> key;
-        return node->del(key);
-        
-    } else if (cmd == "EXISTS") {
-        std::string key;
-        iss >> key;
-        return node->exists(key);
-        
-    } else if (cmd == "INCR") {
-        std::string key;
-        iss >> key;
-        if (key.empty()) {
-            return "-ERR wrong number of arguments for 'incr' command\r\n";
-        }
-        
-        std::lock_guard<std::mutex> lock(node->storageMutex_);
-        auto it = node->storage_.find(key);
-        int value = 0;
-        
-        if (it != node->storage_.end()) {
-            if (it->second.isExpired()) {
-                node->storage_.erase(it);
-            } else {
-                try {
-                    value = std::stoi(it->second.value);
-                } catch (...) {
-                    return "-ERR value is not an integer or out of range\r\n";
-                }
-            }
-        }
-        
-        value++;
-        node->storage_[key] = KVEntry(std::to_string(value));
-        return ":" + std::to_string(value) + "\r\n";
-        
-    } else if (cmd == "DECR") {
-        std::string key;
-        iss >> key;
-        if (key.empty()) {
-            return "-ERR wrong number of arguments for 'decr' command\r\n";
-        }
-        
-        std::lock_guard<std::mutex> lock(node->storageMutex_);
-        auto it = node->storage_.find(key);
-        int value = 0;
-        
-        if (it != node->storage_.end()) {
-            if (it->second.isExpired()) {
-                node->storage_.erase(it);
-            } else {
-                try {
-                    value = std::stoi(it->second.value);
-                } catch (...) {
-                    return "-ERR value is not an integer or out of range\r\n";
-                }
-            }
-        }
-        
-        value--;
-        node->storage_[key] = KVEntry(std::to_string(value));
-        return ":" + std::to_string(value) + "\r\n";
-        
-    } else if (cmd == "INCRBY") {
-        std::string key, incrementStr;
-        iss >> key >> incrementStr;
-        
-        if (key.empty() || incrementStr.empty()) {
-            return "-ERR wrong number of arguments for 'incrby' command\r\n";
-        }
-        
-        int increment;
-        try {
-            increment = std::stoi(incrementStr);
-        } catch (...) {
-            return "-ERR value is not an integer or out of range\r\n";
-        }
-        
-        std::lock_guard<std::mutex> lock(node->storageMutex_);
-        auto it = node->storage_.find(key);
-        int value = 0;
-        
-        if (it != node->storage_.end()) {
-            if (it->second.isExpired()) {
-                node->storage_.erase(it);
-            } else {
-                try {
-                    value = std::stoi(it->second.value);
-                } catch (...) {
-                    return "-ERR value is not an integer or out of range\r\n";
-                }
-            }
-        }
-        
-        value += increment;
-        node->storage_[key] = KVEntry(std::to_string(value));
-        return ":" + std::to_string(value) + "\r\n";
-        
-    } else if (cmd == "DECRBY") {
-        std::string key, decrementStr;
-        iss >> key >> decrementStr;
-        
-        if (key.empty() || decrementStr.empty()) {
-            return "-ERR wrong number of arguments for 'decrby' command\r\n";
-        }
-        
-        int decrement;
-        try {
-            decrement = std::stoi(decrementStr);
-        } catch (...) {
-            return "-ERR value is not an integer or out of range\r\n";
-        }
-        
-        std::lock_guard<std::mutex> lock(node->storageMutex_);
-        auto it = node->storage_.find(key);
-        int value = 0;
-        
-        if (it != node->storage_.end()) {
-            if (it->second.isExpired()) {
-                node->storage_.erase(it);
-            } else {
-                try {
-                    value = std::stoi(it->second.value);
-                } catch (...) {
-                    return "-ERR value is not an integer or out of range\r\n";
-                }
-            }
-        }
-        
-        value -= decrement;
-        node->storage_[key] = KVEntry(std::to_string(value));
-        return ":" + std::to_string(value) + "\r\n";
-        
-    } else if (cmd == "KEYS") {
-        std::string pattern;
-        iss >> pattern;
-        return node->keys(pattern);
-        
-    } else if (cmd == "FLUSHALL") {
-        return node->flushall();
-        
-    } else if (cmd == "PING") {
-        return node->ping();
-        
-    } else if (cmd == "INFO") {
-        std::string info = "# Memory\r\n";
-        info += "used_memory:" + std::to_string(node->getMemoryUsage()) + "\r\n";
-        info += "used_memory_human:" + std::to_string(node->getMemoryUsage() / 1024) + "K\r\n";
-        info += "# Keyspace\r\n";
-        info += "db0:keys=" + std::to_string(node->getKeyCount()) + "\r\n";
-        return "$" + std::to_string(info.size()) + "\r\n" + info + "\r\n";
+    std::unique_lock<std::recursive_mutex> lock(node->storageMutex_, std::defer_lock);
+    if (atomic) {
+        lock.lock();
     }
-    
-    return "-ERR unknown command '" + cmd + "'\r\n";
+    for (const auto& command : commands) {
+        replies.push_back(node->execute(splitCommand(command)));
+    }
+    return replies;
 }
 
 std::vector<std::string> NodeManager::listNodes() {
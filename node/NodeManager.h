@@ -7,56 +7,227 @@
 #include <atomic>
 #include <chrono>
 #include <vector>
+#include <array>
+#include <string_view>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <condition_variable>
+#include "TimingWheel.h"
+#include "DataTypes.h"
+#include "../common/SwissTable.h"
+#include "../common/CommandTable.h"
 
 // Forward declaration
 class NodeManager;
 
+// maxmemory-policy: what a write does when the tenant is at its memory limit
+enum class EvictionPolicy {
+    NoEviction,   // reject the write with OOM
+    AllKeysLRU,   // evict the least recently used key
+    AllKeysLFU,   // evict the least frequently used key
+    VolatileLRU,  // LRU among keys with a TTL
+    VolatileTTL   // key with the nearest expiry
+};
+
+bool parseEvictionPolicy(const std::string& name, EvictionPolicy& out);
+std::vector<std::string_view> splitCommand(const std::string& command);
+const char* evictionPolicyName(EvictionPolicy policy);
+
+// Parses a canonical 64-bit integer: optional '-', no leading zeros or '+',
+// nothing else (Redis's rule for what INCR accepts and what gets int-encoded)
+bool parseInt64(std::string_view s, int64_t& out);
+
+// Redis glob match for KEYS and SCAN MATCH: '*' (any run), '?' (any byte),
+// '[abc]', '[a-z]' and '[^...]' classes, and '\' quoting the next byte
+bool globMatch(std::string_view pattern, std::string_view text);
+
 // Key-Value entry with TTL support
 struct KVEntry {
     std::string value;
     std::chrono::steady_clock::time_point expiry;
     bool hasExpiry;
     
+    // Integer encoding: a value that parses as a canonical int64 is kept as
+    // its 8 raw bytes in `value` (inline, SSO), so INCR and friends update it
+    // in place without allocating; it is turned back into text only when read.
+    bool isInt = false;
+    
+    // Eviction metadata, packed into the padding after hasExpiry:
+    // Morris (logarithmic) access counter for LFU and last access time in ms for LRU/LFU decay
+    uint8_t lfuCounter = 0;
+    
+    // Any type but String keeps a pointer to its DataObject in `value`'s
+    // inline bytes, the same way as an integer, and the entry owns it; a
+    // string key pays nothing for the other types.
+    ValueType type = ValueType::String;
+    
+    uint32_t accessClock = 0;
+    
+    // Deadline (ms) of this key's pending expiry-wheel entry, 0 if none
+    uint64_t wheelDeadline = 0;
+    
     // Default constructor
     KVEntry() : value(""), hasExpiry(false) {}
     
+    ~KVEntry() { releaseObject(); }
+    
+    // Move-only, so exactly one entry owns a DataObject
+    KVEntry(KVEntry&& other) noexcept : hasExpiry(false) { *this = std::move(other); }
+    
+    KVEntry& operator=(KVEntry&& other) noexcept {
+        if (this != &other) {
+            releaseObject();
+            value = std::move(other.value);
+            expiry = other.expiry;
+            hasExpiry = other.hasExpiry;
+            isInt = other.isInt;
+            lfuCounter = other.lfuCounter;
+            type = other.type;
+            accessClock = other.accessClock;
+            wheelDeadline = other.wheelDeadline;
+            other.type = ValueType::String;
+            other.value.clear();
+        }
+        return *this;
+    }
+    
+    KVEntry(const KVEntry&) = delete;
+    KVEntry& operator=(const KVEntry&) = delete;
+    
     KVEntry(const std::string& val) 
-        : value(val), hasExpiry(false) {}
+        : hasExpiry(false) { assign(val); }
+    
+    KVEntry(const std::string& val, std::chrono::milliseconds ttl)
+        : expiry(std::chrono::steady_clock::now() + ttl),
+          hasExpiry(true) { assign(val); }
+    
+    static KVEntry integer(int64_t v) {
+        KVEntry entry;
+        entry.setInt(v);
+        return entry;
+    }
+    
+    // A fresh, empty collection of the given type
+    static KVEntry collection(ValueType type) {
+        KVEntry entry;
+        DataObject* object = nullptr;
+        switch (type) {
+            case ValueType::Hash: object = new HashObject(); break;
+            case ValueType::List: object = new ListObject(); break;
+            case ValueType::Set: object = new SetObject(); break;
+            case ValueType::ZSet: object = new ZSetObject(); break;
+            case ValueType::String: return entry;
+        }
+        std::string(sizeof(object), '\0').swap(entry.value);
+        std::memcpy(&entry.value[0], &object, sizeof(object));
+        entry.type = type;
+        return entry;
+    }
+    
+    DataObject* object() const {
+        DataObject* object;
+        std::memcpy(&object, value.data(), sizeof(object));
+        return object;
+    }
+    
+    // The collection, if the entry holds one of type T::TYPE
+    template <typename T>
+    T* as() const { return type == T::TYPE ? static_cast<T*>(object()) : nullptr; }
+    
+    void assign(const std::string& val) {
+        int64_t v;
+        if (parseInt64(val, v)) {
+            setInt(v);
+        } else {
+            isInt = false;
+            value = val;
+        }
+    }
     
-    KVEntry(const std::string& val, int ttlSeconds)
-        : value(val), 
-          expiry(std::chrono::steady_clock::now() + std::chrono::seconds(ttlSeconds)),
-          hasExpiry(true) {}
+    int64_t intValue() const {
+        int64_t v;
+        std::memcpy(&v, value.data(), sizeof(v));
+        return v;
+    }
+    
+    void setInt(int64_t v) {
+        if (!isInt) {
+            std::string(sizeof(v), '\0').swap(value);  // drops any heap buffer
+            isInt = true;
+        }
+        std::memcpy(&value[0], &v, sizeof(v));
+    }
+    
+    // The value as clients see it
+    std::string str() const { return isInt ? std::to_string(intValue()) : value; }
     
     bool isExpired() const {
         return hasExpiry && std::chrono::steady_clock::now() > expiry;
     }
+    
+private:
+    void releaseObject() {
+        if (type != ValueType::String) {
+            delete object();
+            type = ValueType::String;
+        }
+    }
 };
 
+// Keyspace slot: the key and its entry, stored inline in the table
+using KVSlot = std::pair<std::string, KVEntry>;
+
+struct KVSlotKey {
+    std::string_view operator()(const KVSlot& slot) const { return slot.first; }
+};
+
+using KVTable = SwissTable<KVSlot, KVSlotKey>;
+
 // In-Memory Redis Node (40MB limit per tenant)
-class RedisNode {
+class RedisNode : public std::enable_shared_from_this<RedisNode> {
 public:
-    RedisNode(const std::string& tenantId, int port, int memoryLimitMb);
+    RedisNode(const std::string& tenantId, int port, int memoryLimitMb,
+              EvictionPolicy policy = EvictionPolicy::AllKeysLRU);
     ~RedisNode();
 
+    // Longest a command (or one background step) may spend moving keys while
+    // storage_ grows (NODE_REHASH_BUDGET_US); applies to nodes created afterwards
+    static void setRehashBudget(std::chrono::microseconds budget);
+
     // Redis commands
-    std::string set(const std::string& key, const std::string& value, int ttl = 0);
-    std::string get(const std::string& key);
-    std::string del(const std::string& key);
-    std::string exists(const std::string& key);
+    std::string set(const std::string& key, const std::string& value, long long ttlMs = 0);
+    std::string get(std::string_view key);
+    std::string del(std::string_view key);
+    std::string exists(std::string_view key);
+    // INCR/DECR/INCRBY/DECRBY: adds delta to the key's integer, creating it
+    // at 0; keeps the key's TTL and refuses to overflow int64
+    std::string incrBy(std::string_view key, int64_t delta);
     std::string keys(const std::string& pattern);
     std::string flushall();
     std::string ping();
+    std::string info();
+    
+    // Runs one command (argv[0] is its name) and returns the RESP reply
+    std::string execute(const std::vector<std::string_view>& argv);
     
     // Node info
     std::string getTenantId() const { return tenantId_; }
     int getPort() const { return port_; }
     size_t getMemoryUsage() const;
     size_t getKeyCount() const;
+    EvictionPolicy getEvictionPolicy() const { return policy_; }
+    size_t getEvictedKeys() const { return evictedKeys_; }
+    // getMemoryUsage() recomputed from every entry in O(keys); the two differ
+    // only if the incremental accounting has drifted
+    size_t recountMemory() const;
     bool isRunning() const { return running_; }
     
+    // start() also opens the node's RESP listener on port_ (see RespServer);
+    // the node keeps serving over HTTP if the port cannot be bound.
     void start();
     void stop();
+    bool isListening() const { return listenerId_ >= 0; }
 
 private:
     // ✅ ADD THIS LINE - Allow NodeManager to access private members
@@ -66,18 +237,124 @@ private:
     int port_;
     size_t memoryLimitBytes_;
     std::atomic<bool> running_;
+    std::atomic<int> listenerId_{-1};  // RespServer listener, -1 when not listening
     
     // In-memory storage (thread-safe)
-    std::unordered_map<std::string, KVEntry> storage_;
-    mutable std::mutex storageMutex_;
+    KVTable storage_;
+    // Recursive so a batch can hold it across many commands (NodeManager::executeBatch)
+    mutable std::recursive_mutex storageMutex_;
     
-    // TTL sweeper thread (removes expired keys)
+    // Heap bytes held by storage_ keys and values outside the table, maintained
+    // on every insert/overwrite/erase (guarded by storageMutex_). Table slots
+    // are added on read.
+    size_t usedMemory_ = 0;
+    
+    // Heap footprint of one entry outside its table slot: key and value buffers,
+    // or for a collection, whatever its DataObject holds
+    static size_t entrySize(const std::string& key, const KVEntry& entry);
+    static size_t valueSize(const KVEntry& entry);
+    size_t memoryUsageLocked() const;
+    
+    // All storage_ mutations go through these so usedMemory_ stays exact
+    KVSlot* storeEntry(const std::string& key, KVEntry&& entry);
+    void eraseEntry(KVSlot* slot);
+    
+    // TTL expiry: only keys with hasExpiry are filed in the wheel. The sweeper
+    // sleeps on sweeperCv_ (with storageMutex_) until the next due tick and
+    // expires keys in bounded batches, releasing the lock between batches.
+    // While storage_ is growing it also wakes every REHASH_INTERVAL to move
+    // keys into the new table, so an idle node finishes the migration too.
     std::thread sweeperThread_;
+    TimingWheel expiryWheel_;
+    std::condition_variable_any sweeperCv_;
+    uint64_t sweeperWakeMs_ = 0;
     void ttlSweeperLoop();
+    void scheduleExpiry(const std::string& key, KVEntry& entry);
+    void onExpiryDue(const std::string& key, uint64_t deadline, uint64_t nowMs);
+    
+    static std::chrono::microseconds rehashBudget_;
+    
+    // Memory management (sampled LRU/LFU/TTL eviction, see EvictionPolicy)
+    struct EvictionCandidate {
+        uint64_t score;  // higher = better to evict
+        std::string key;
+    };
+    
+    EvictionPolicy policy_;
+    std::vector<EvictionCandidate> evictionPool_;  // sorted by score, ascending
+    std::mt19937 rng_;
+    std::atomic<size_t> evictedKeys_{0};
     
-    // Memory management (LRU eviction)
-    bool checkMemoryLimit(size_t additionalBytes);
-    void evictLRU();
+    void touch(KVEntry& entry);
+    uint64_t evictionScore(const KVEntry& entry, uint32_t now) const;
+    void sampleEvictionCandidates(const std::string& keep);
+    bool evictOne(const std::string& keep);
+    
+    // Command handlers by CommandId, null for commands the node lacks;
+    // execute() has checked argv against the command's arity
+    using CommandHandler = std::string (RedisNode::*)(const std::vector<std::string_view>& argv);
+    static const std::array<CommandHandler, CMD_COUNT> commandHandlers_;
+    
+    std::string setCommand(const std::vector<std::string_view>& argv);
+    std::string getCommand(const std::vector<std::string_view>& argv);
+    std::string delCommand(const std::vector<std::string_view>& argv);
+    std::string existsCommand(const std::vector<std::string_view>& argv);
+    std::string incrCommand(const std::vector<std::string_view>& argv);
+    std::string decrCommand(const std::vector<std::string_view>& argv);
+    std::string incrbyCommand(const std::vector<std::string_view>& argv);
+    std::string decrbyCommand(const std::vector<std::string_view>& argv);
+    std::string keysCommand(const std::vector<std::string_view>& argv);
+    std::string scanCommand(const std::vector<std::string_view>& argv);
+    std::string flushallCommand(const std::vector<std::string_view>& argv);
+    std::string pingCommand(const std::vector<std::string_view>& argv);
+    std::string infoCommand(const std::vector<std::string_view>& argv);
+    std::string commandCommand(const std::vector<std::string_view>& argv);
+    std::string typeCommand(const std::vector<std::string_view>& argv);
+    std::string hsetCommand(const std::vector<std::string_view>& argv);
+    std::string hgetCommand(const std::vector<std::string_view>& argv);
+    std::string hdelCommand(const std::vector<std::string_view>& argv);
+    std::string hgetallCommand(const std::vector<std::string_view>& argv);
+    std::string hlenCommand(const std::vector<std::string_view>& argv);
+    std::string hexistsCommand(const std::vector<std::string_view>& argv);
+    std::string hincrbyCommand(const std::vector<std::string_view>& argv);
+    std::string lpushCommand(const std::vector<std::string_view>& argv);
+    std::string rpushCommand(const std::vector<std::string_view>& argv);
+    std::string lpopCommand(const std::vector<std::string_view>& argv);
+    std::string rpopCommand(const std::vector<std::string_view>& argv);
+    std::string llenCommand(const std::vector<std::string_view>& argv);
+    std::string lrangeCommand(const std::vector<std::string_view>& argv);
+    std::string lindexCommand(const std::vector<std::string_view>& argv);
+    std::string saddCommand(const std::vector<std::string_view>& argv);
+    std::string sremCommand(const std::vector<std::string_view>& argv);
+    std::string sismemberCommand(const std::vector<std::string_view>& argv);
+    std::string smembersCommand(const std::vector<std::string_view>& argv);
+    std::string scardCommand(const std::vector<std::string_view>& argv);
+    std::string zaddCommand(const std::vector<std::string_view>& argv);
+    std::string zremCommand(const std::vector<std::string_view>& argv);
+    std::string zscoreCommand(const std::vector<std::string_view>& argv);
+    std::string zcardCommand(const std::vector<std::string_view>& argv);
+    std::string zrankCommand(const std::vector<std::string_view>& argv);
+    std::string zrangeCommand(const std::vector<std::string_view>& argv);
+    std::string zrangebyscoreCommand(const std::vector<std::string_view>& argv);
+    
+    // Collection access, under storageMutex_. readSlot finds a live key and
+    // sets error to WRONGTYPE if it holds another type. writeSlot also makes
+    // room for `growth` more bytes (evicting other keys, else error is the
+    // OOM reply) and creates an empty collection of the type if key is absent.
+    KVSlot* readSlot(std::string_view key, ValueType type, std::string& error);
+    KVSlot* writeSlot(std::string_view key, ValueType type, size_t growth, std::string& error);
+    
+    // One stretch of a keyspace walk, under storageMutex_: visits storage_
+    // from cursor until about count keys have gone by, appends the live ones
+    // that match pattern (and type, unless null) to out, and returns the next
+    // cursor, 0 at the end. KEYS and SCAN both walk this way.
+    size_t scanKeys(size_t cursor, size_t count, std::string_view pattern,
+                    const ValueType* type, std::vector<std::string>& out);
+    std::string pushCommand(const std::vector<std::string_view>& argv, bool front);
+    std::string popCommand(const std::vector<std::string_view>& argv, bool front);
+    // Re-adds the entry's memory after a collection changed, dropping the key
+    // if the collection is now empty (collections never exist empty)
+    void finishWrite(KVSlot* slot);
 };
 
 // Node Manager - manages multiple tenant nodes
@@ -86,16 +363,24 @@ public:
     NodeManager();
     ~NodeManager();
 
-    bool startNode(const std::string& tenantId, int port, int memoryLimitMb = 40);
+    bool startNode(const std::string& tenantId, int port, int memoryLimitMb = 40,
+                   EvictionPolicy policy = EvictionPolicy::AllKeysLRU);
     bool stopNode(const std::string& tenantId);
     
     std::shared_ptr<RedisNode> getNode(const std::string& tenantId);
     
     std::string executeCommand(const std::string& tenantId, const std::string& command);
+    
+    // Runs commands for one tenant after a single node lookup. With atomic set,
+    // the node's storage lock is held for the whole batch (MULTI/EXEC-like).
+    std::vector<std::string> executeBatch(const std::string& tenantId,
+                                          const std::vector<std::string>& commands,
+                                          bool atomic = false);
     std::vector<std::string> listNodes();
     void stopAllNodes();
 
 private:
     std::unordered_map<std::string, std::shared_ptr<RedisNode>> nodes_;
+
     mutable std::mutex nodesMutex_;
 };
\ No newline at end of file
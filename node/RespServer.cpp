@@ -0,0 +1,395 @@
+#include "RespServer.h"
+#include "../common/RespParser.h"
+#include "../common/CommandTable.h"
+#include <iostream>
+#include <future>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace {
+    const size_t READ_CHUNK = 16 * 1024;
+    const int MAX_EVENTS = 256;
+
+    // Stop reading from a client whose unsent replies pass this; resume once drained
+    const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+
+    bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+}
+
+int RespServer::threadCount_ = 2;
+
+void RespServer::setThreadCount(int threads) {
+    threadCount_ = std::max(1, threads);
+}
+
+RespServer& RespServer::instance() {
+    static RespServer server(threadCount_);
+    return server;
+}
+
+RespServer::RespServer(int threads) {
+    for (int i = 0; i < threads; i++) {
+        auto loop = std::make_unique<Loop>();
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = loop->wakeFd;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &ev);
+
+        loops_.push_back(std::move(loop));
+    }
+    for (auto& loop : loops_) {
+        Loop* l = loop.get();
+        l->thread = std::thread([this, l] { run(*l); });
+    }
+    std::cout << "[RespServer] " << threads << " event loop thread(s) started" << std::endl;
+}
+
+RespServer::~RespServer() {
+    running_ = false;
+    for (auto& loop : loops_) {
+        uint64_t one = 1;
+        ssize_t ignored = write(loop->wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+        for (auto& [fd, conn] : loop->conns) {
+            ::close(fd);
+        }
+        for (auto& [fd, listener] : loop->listeners) {
+            ::close(fd);
+        }
+        ::close(loop->wakeFd);
+        ::close(loop->epollFd);
+    }
+}
+
+int RespServer::listen(int port, Handler handler) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "[RespServer] socket() failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(fd, SOMAXCONN) < 0 || !setNonBlocking(fd)) {
+        std::cerr << "[RespServer] Cannot listen on port " << port << ": "
+                  << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+
+    auto listener = std::make_shared<Listener>();
+    listener->id = nextListenerId_++;
+    listener->fd = fd;
+    listener->loop = nextLoop_++ % loops_.size();
+    listener->handler = std::move(handler);
+    {
+        std::lock_guard<std::mutex> lock(listenersMutex_);
+        listeners_[listener->id] = listener;
+    }
+
+    Loop& loop = *loops_[listener->loop];
+    post(loop, [&loop, listener] {
+        loop.listeners[listener->fd] = listener;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = listener->fd;
+        epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, listener->fd, &ev);
+    });
+
+    return listener->id;
+}
+
+void RespServer::close(int listenerId) {
+    std::shared_ptr<Listener> listener;
+    {
+        std::lock_guard<std::mutex> lock(listenersMutex_);
+        auto it = listeners_.find(listenerId);
+        if (it == listeners_.end()) {
+            return;
+        }
+        listener = it->second;
+        listeners_.erase(it);
+    }
+    listener->closed = true;
+
+    // Every loop drops the listener's connections; the owner also closes the
+    // listening socket. A connection still in flight to another loop sees
+    // closed in adopt() and is refused.
+    std::vector<std::future<void>> done;
+    for (size_t i = 0; i < loops_.size(); i++) {
+        auto finished = std::make_shared<std::promise<void>>();
+        done.push_back(finished->get_future());
+
+        Loop& loop = *loops_[i];
+        bool isOwner = i == listener->loop;
+        post(loop, [this, &loop, listener, isOwner, finished] {
+            std::vector<int> dropping;
+            for (auto& [fd, conn] : loop.conns) {
+                if (conn->listener == listener) {
+                    dropping.push_back(fd);
+                }
+            }
+            for (int fd : dropping) {
+                closeConnection(loop, fd);
+            }
+
+            if (isOwner) {
+                if (loop.listeners.erase(listener->fd)) {
+                    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, listener->fd, nullptr);
+                    ::close(listener->fd);
+                }
+            }
+            finished->set_value();
+        });
+    }
+    for (auto& f : done) {
+        f.wait();
+    }
+}
+
+void RespServer::post(Loop& loop, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(loop.tasksMutex);
+        loop.tasks.push_back(std::move(task));
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(loop.wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void RespServer::runTasks(Loop& loop) {
+    uint64_t count;
+    while (read(loop.wakeFd, &count, sizeof(count)) > 0) {
+    }
+
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(loop.tasksMutex);
+        tasks.swap(loop.tasks);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void RespServer::run(Loop& loop) {
+    epoll_event events[MAX_EVENTS];
+
+    while (running_) {
+        int n = epoll_wait(loop.epollFd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[RespServer] epoll_wait failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+
+            if (fd == loop.wakeFd) {
+                runTasks(loop);
+                continue;
+            }
+
+            auto lit = loop.listeners.find(fd);
+            if (lit != loop.listeners.end()) {
+                acceptAll(loop, lit->second);
+                continue;
+            }
+
+            auto cit = loop.conns.find(fd);
+            if (cit == loop.conns.end()) {
+                continue;  // closed earlier in this batch
+            }
+            Connection& conn = *cit->second;
+
+            if (ev & EPOLLERR) {
+                closeConnection(loop, fd);
+                continue;
+            }
+
+            if (ev & EPOLLOUT) {
+                bool wasPaused = conn.out.size() - conn.outOffset > MAX_PENDING_OUTPUT;
+                if (!flush(conn) || (conn.out.empty() && conn.closeAfterFlush)) {
+                    closeConnection(loop, fd);
+                    continue;
+                }
+                if (wasPaused && conn.out.empty()) {
+                    onReadable(loop, conn);  // reads skipped while the client was behind
+                    continue;
+                }
+            }
+
+            if (ev & (EPOLLIN | EPOLLHUP)) {
+                onReadable(loop, conn);
+            }
+        }
+    }
+}
+
+void RespServer::acceptAll(Loop& loop, const std::shared_ptr<Listener>& listener) {
+    while (true) {
+        int fd = accept4(listener->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[RespServer] accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        // Spread clients over the pool rather than pinning a tenant to one loop
+        Loop& target = *loops_[nextLoop_++ % loops_.size()];
+        if (&target == &loop) {
+            adopt(loop, fd, listener);
+        } else {
+            post(target, [this, &target, fd, listener] { adopt(target, fd, listener); });
+        }
+    }
+}
+
+void RespServer::adopt(Loop& loop, int fd, std::shared_ptr<Listener> listener) {
+    if (listener->closed) {
+        ::close(fd);  // listener closed while the connection was in flight
+        return;
+    }
+
+    auto conn = std::make_unique<Connection>();
+    conn->fd = fd;
+    conn->listener = std::move(listener);
+    loop.conns[fd] = std::move(conn);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd;
+    if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        loop.conns.erase(fd);
+        ::close(fd);
+    }
+}
+
+void RespServer::onReadable(Loop& loop, Connection& conn) {
+    int fd = conn.fd;
+    std::vector<std::string_view> argv;
+    bool peerClosed = false;
+
+    while (!peerClosed && !conn.closeAfterFlush) {
+        if (conn.out.size() - conn.outOffset > MAX_PENDING_OUTPUT) {
+            return;  // resumed from EPOLLOUT once the client catches up
+        }
+
+        size_t used = conn.in.size();
+        conn.in.resize(used + std::max(READ_CHUNK, conn.needed > used ? conn.needed - used : 0));
+        ssize_t n = recv(fd, conn.in.data() + used, conn.in.size() - used, 0);
+        if (n < 0) {
+            conn.in.resize(used);
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            closeConnection(loop, fd);
+            return;
+        }
+        conn.in.resize(used + static_cast<size_t>(n));
+        if (n == 0) {
+            peerClosed = true;
+        }
+        if (conn.in.size() < conn.needed) {
+            continue;
+        }
+
+        // Run every complete request in the buffer; replies queue up in order
+        size_t pos = 0;
+        conn.needed = 0;
+        while (pos < conn.in.size()) {
+            size_t consumed = 0, needed = 0;
+            const char* error = nullptr;
+            RespParser::Status st = RespParser::parse(conn.in.data() + pos, conn.in.size() - pos,
+                                                      consumed, argv, needed, error);
+            if (st == RespParser::Incomplete) {
+                conn.needed = needed;
+                break;
+            }
+            if (st == RespParser::Error) {
+                conn.out += error;
+                conn.closeAfterFlush = true;
+                break;
+            }
+
+            pos += consumed;
+            if (argv.empty()) {
+                continue;
+            }
+            if (CommandTable::is(argv[0], CMD_QUIT)) {
+                conn.out += "+OK\r\n";
+                conn.closeAfterFlush = true;
+                break;
+            }
+            conn.out += conn.listener->handler(argv);
+        }
+        conn.in.erase(conn.in.begin(), conn.in.begin() + pos);
+
+        if (!flush(conn)) {
+            closeConnection(loop, fd);
+            return;
+        }
+    }
+
+    if (peerClosed && !conn.out.empty()) {
+        conn.closeAfterFlush = true;  // finish sending what the client asked for
+        return;
+    }
+    if (peerClosed || (conn.closeAfterFlush && conn.out.empty())) {
+        closeConnection(loop, fd);
+    }
+}
+
+bool RespServer::flush(Connection& conn) {
+    while (conn.outOffset < conn.out.size()) {
+        ssize_t n = send(conn.fd, conn.out.data() + conn.outOffset,
+                         conn.out.size() - conn.outOffset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;  // rest goes out on EPOLLOUT
+        }
+        conn.outOffset += static_cast<size_t>(n);
+    }
+    conn.out.clear();
+    conn.outOffset = 0;
+    return true;
+}
+
+void RespServer::closeConnection(Loop& loop, int fd) {
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    loop.conns.erase(fd);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+// Native RESP front end for tenant nodes.
+//
+// One process-wide pool of epoll event loops serves every tenant's port, so the
+// thread count does not grow with the number of nodes. Each loop owns its
+// sockets outright: listeners and connections are only touched on their loop's
+// thread, and other threads reach a loop by posting a task to it. Connections
+// are non-blocking and edge-triggered; all requests that arrive in one read are
+// run in order and their replies go out in a single send.
+class RespServer {
+public:
+    // Runs one parsed command and returns its RESP reply
+    using Handler = std::function<std::string(const std::vector<std::string_view>&)>;
+
+    // Pool size used when the singleton is first created (NODE_RESP_THREADS)
+    static void setThreadCount(int threads);
+    static RespServer& instance();
+
+    ~RespServer();
+
+    // Binds 0.0.0.0:port and serves it with handler. Returns a listener id for
+    // close(), or -1 if the port could not be bound.
+    int listen(int port, Handler handler);
+
+    // Stops accepting on the listener and drops its connections. Returns once
+    // the listening socket is closed, so the port can be bound again.
+    void close(int listenerId);
+
+private:
+    struct Listener {
+        int id;
+        int fd;
+        size_t loop;              // index of the loop that accepts on fd
+        Handler handler;
+        std::atomic<bool> closed{false};
+    };
+
+    struct Connection {
+        int fd;
+        std::shared_ptr<Listener> listener;
+        std::vector<char> in;
+        size_t needed = 0;        // buffer size the parser asked for before retrying
+        std::string out;
+        size_t outOffset = 0;     // bytes of out already sent
+        bool closeAfterFlush = false;
+    };
+
+    struct Loop {
+        int epollFd = -1;
+        int wakeFd = -1;
+        std::thread thread;
+        std::mutex tasksMutex;
+        std::vector<std::function<void()>> tasks;
+        std::unordered_map<int, std::shared_ptr<Listener>> listeners;   // by listening fd
+        std::unordered_map<int, std::unique_ptr<Connection>> conns;     // by client fd
+    };
+
+    explicit RespServer(int threads);
+
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<bool> running_{true};
+    std::atomic<size_t> nextLoop_{0};
+    std::atomic<int> nextListenerId_{1};
+
+    std::mutex listenersMutex_;
+    std::unordered_map<int, std::shared_ptr<Listener>> listeners_;  // by listener id
+
+    static int threadCount_;
+
+    void post(Loop& loop, std::function<void()> task);
+    void run(Loop& loop);
+    void runTasks(Loop& loop);
+    void acceptAll(Loop& loop, const std::shared_ptr<Listener>& listener);
+    void adopt(Loop& loop, int fd, std::shared_ptr<Listener> listener);
+    void onReadable(Loop& loop, Connection& conn);
+    bool flush(Connection& conn);
+    void closeConnection(Loop& loop, int fd);
+};
@@ -0,0 +1,130 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Hierarchical timing wheel for key expiry (1 ms ticks, 6 levels x 256 slots).
+//
+// A deadline is filed at the level of the highest 8-bit group in which it
+// differs from the current tick, so level 0 holds the next 256 ms, level 1 the
+// next ~65 s and so on. When the current tick enters a new group, the matching
+// slot one level up is cascaded down. Advancing only ever touches due slots,
+// and no operation looks at keys that have no TTL.
+//
+// The wheel is not thread-safe; RedisNode drives it under storageMutex_.
+class TimingWheel {
+public:
+    struct Entry {
+        std::string key;
+        uint64_t deadline;
+    };
+
+    explicit TimingWheel(uint64_t nowMs = 0) : current_(nowMs) {
+        for (auto& level : slots_) {
+            level.resize(SLOTS);
+        }
+    }
+
+    void schedule(const std::string& key, uint64_t deadlineMs) {
+        place(Entry{key, deadlineMs});
+        size_++;
+    }
+
+    // Fires every entry due at or before nowMs, at most `budget` of them.
+    // Returns true once the wheel has caught up with nowMs.
+    template <typename OnDue>
+    bool advance(uint64_t nowMs, size_t budget, OnDue&& onDue) {
+        if (size_ == 0) {
+            if (nowMs >= current_) {
+                current_ = nowMs + 1;
+                cascaded_ = false;
+            }
+            return true;
+        }
+
+        while (current_ <= nowMs) {
+            if (!cascaded_) {
+                cascade();
+                cascaded_ = true;
+            }
+
+            std::vector<Entry>& slot = slots_[0][current_ & MASK];
+            while (!slot.empty()) {
+                if (budget == 0) {
+                    return false;
+                }
+                Entry e = std::move(slot.back());
+                slot.pop_back();
+                size_--;
+                budget--;
+                onDue(e.key, e.deadline);
+            }
+
+            current_++;
+            cascaded_ = false;
+        }
+        return true;
+    }
+
+    // Earliest tick at which advance() may have work; exact for the next 256 ms,
+    // otherwise the next cascade boundary.
+    uint64_t nextDeadline() const {
+        if (size_ == 0) {
+            return UINT64_MAX;
+        }
+        for (uint64_t t = current_; (t & ~MASK) == (current_ & ~MASK); ++t) {
+            if (!slots_[0][t & MASK].empty()) {
+                return t;
+            }
+        }
+        return (current_ | MASK) + 1;
+    }
+
+    size_t size() const { return size_; }
+
+    void clear() {
+        for (auto& level : slots_) {
+            for (auto& slot : level) {
+                std::vector<Entry>().swap(slot);
+            }
+        }
+        size_ = 0;
+    }
+
+private:
+    static const int LEVELS = 6;
+    static const int BITS = 8;
+    static const uint64_t SLOTS = 1ULL << BITS;
+    static const uint64_t MASK = SLOTS - 1;
+
+    std::vector<std::vector<Entry>> slots_[LEVELS];
+    uint64_t current_;        // next tick to fire; everything earlier has fired
+    bool cascaded_ = false;   // current_'s cascade already ran
+    size_t size_ = 0;
+
+    void place(Entry&& e) {
+        uint64_t d = e.deadline < current_ ? current_ : e.deadline;
+        int level = 0;
+        while (level < LEVELS - 1 && (d >> (BITS * (level + 1))) != (current_ >> (BITS * (level + 1)))) {
+            level++;
+        }
+        slots_[level][(d >> (BITS * level)) & MASK].push_back(std::move(e));
+    }
+
+    // Re-files the slots whose range starts at current_, top level first so
+    // entries cascading through several levels land in slots not yet drained.
+    void cascade() {
+        int top = 0;
+        while (top < LEVELS - 1 && (current_ & ((1ULL << (BITS * (top + 1))) - 1)) == 0) {
+            top++;
+        }
+        for (int level = top; level >= 1; --level) {
+            std::vector<Entry> moving;
+            moving.swap(slots_[level][(current_ >> (BITS * level)) & MASK]);
+            for (auto& e : moving) {
+                place(std::move(e));
+            }
+        }
+    }
+};
@@ -1,6 +1,7 @@
 #include <drogon/drogon.h>
 #include <iostream>
 #include "NodeManager.h"
+#include "RespServer.h"
 #include "../config/config.h"
 
 using namespace drogon;
@@ -27,6 +28,10 @@ int main() {
         std::cout << "[NodeManager]  Configuration loaded\n";
         std::cout << "[NodeManager] DB Host: " << dbHost << "\n\n";
 
+        // Event loops shared by every tenant's native RESP port
+        RespServer::setThreadCount(EnvLoader::getInt("NODE_RESP_THREADS", 2));
+        RedisNode::setRehashBudget(std::chrono::microseconds(EnvLoader::getInt("NODE_REHASH_BUDGET_US", 100)));
+
         nodeManager = new NodeManager();
 
         app().registerHandler(
@@ -50,19 +55,32 @@ int main() {
                 std::string tenantId = (*json)["tenant_id"].asString();
                 int port = (*json)["port"].asInt();
                 int memoryMb = (*json).get("memory_limit_mb", 40).asInt();
+                std::string policyName = (*json).get("maxmemory_policy", "allkeys-lru").asString();
+
+                EvictionPolicy policy;
+                if (!parseEvictionPolicy(policyName, policy)) {
+                    Json::Value error;
+                    error["error"] = "Unknown maxmemory_policy: " + policyName;
+                    auto resp = HttpResponse::newHttpJsonResponse(error);
+                    resp->setStatusCode(k400BadRequest);
+                    callback(resp);
+                    return;
+                }
 
                 std::cout << "[NodeManager] Starting node:" << std::endl;
                 std::cout << "  Tenant ID: " << tenantId << std::endl;
                 std::cout << "  Port: " << port << std::endl;
                 std::cout << "  Memory: " << memoryMb << "MB" << std::endl;
+                std::cout << "  Policy: " << evictionPolicyName(policy) << std::endl;
 
-                bool success = nodeManager->startNode(tenantId, port, memoryMb);
+                bool success = nodeManager->startNode(tenantId, port, memoryMb, policy);
 
                 Json::Value response;
                 response["success"] = success;
                 response["tenant_id"] = tenantId;
                 response["port"] = port;
                 response["memory_limit_mb"] = memoryMb;
+                response["maxmemory_policy"] = evictionPolicyName(policy);
 
                 auto resp = HttpResponse::newHttpJsonResponse(response);
                 resp->setStatusCode(success ? k200OK : k500InternalServerError);
@@ -80,19 +98,12 @@ int main() {
             [](const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
                 auto json = req->getJsonObject();
                 
-                std::cout << "[NodeManager] Execute request:" << std::endl;
-                std::cout << "  Raw JSON: " << json->toStyledString() << std::endl;
-                
                 std::string tenantId = (*json)["tenant_id"].asString();
                 std::string command = (*json)["command"].asString();
 
-                std::cout << "[NodeManager] Executing for tenant: " << tenantId << std::endl;
-                std::cout << "[NodeManager] Command: " << command << std::endl;
-
+                // Per-command logging is left out of this hot path on purpose
                 std::string result = nodeManager->executeCommand(tenantId, command);
 
-                std::cout << "[NodeManager] Result: " << result << std::endl;
-
                 auto resp = HttpResponse::newHttpResponse();
                 resp->setBody(result);
                 resp->setContentTypeCode(CT_TEXT_PLAIN);
@@ -101,6 +112,61 @@ int main() {
             {Post}
         );
 
+        // Endpoint: Execute many commands for one tenant in one round-trip
+        app().registerHandler(
+            "/node/execute_batch",
+            [](const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+                auto json = req->getJsonObject();
+                const Json::ArrayIndex maxBatch = 10000;
+
+                bool valid = json && json->isMember("tenant_id") && (*json)["commands"].isArray() &&
+                             (*json)["commands"].size() <= maxBatch;
+                if (valid) {
+                    // asString() throws on arrays and objects; reject them here as a 400
+                    for (const auto& command : (*json)["commands"]) {
+                        if (!command.isString()) {
+                            valid = false;
+                            break;
+                        }
+                    }
+                }
+                if (!valid) {
+                    Json::Value error;
+                    error["error"] = "Expected tenant_id and a commands array of strings (max 10000)";
+                    auto resp = HttpResponse::newHttpJsonResponse(error);
+                    resp->setStatusCode(k400BadRequest);
+                    callback(resp);
+                    return;
+                }
+
+                std::string tenantId = (*json)["tenant_id"].asString();
+                bool atomic = (*json).get("atomic", false).asBool();
+                const Json::Value& commands = (*json)["commands"];
+
+                std::vector<std::string> batch;
+                batch.reserve(commands.size());
+                for (const auto& command : commands) {
+                    batch.push_back(command.asString());
+                }
+
+                std::cout << "[NodeManager] Batch for tenant " << tenantId << ": "
+                          << batch.size() << " command(s)" << (atomic ? " (atomic)" : "") << std::endl;
+
+                auto replies = nodeManager->executeBatch(tenantId, batch, atomic);
+
+                Json::Value response;
+                response["tenant_id"] = tenantId;
+                Json::Value& out = response["replies"];
+                out = Json::Value(Json::arrayValue);
+                for (const auto& reply : replies) {
+                    out.append(reply);
+                }
+
+                callback(HttpResponse::newHttpJsonResponse(response));
+            },
+            {Post}
+        );
+
         // Endpoint: Stop node
         app().registerHandler(
             "/node/stop",
@@ -133,9 +199,11 @@ int main() {
                         Json::Value nodeInfo;
                         nodeInfo["tenant_id"] = tenantId;
                         nodeInfo["port"] = node->getPort();
+                        nodeInfo["resp_listening"] = node->isListening();
                         nodeInfo["status"] = node->isRunning() ? "running" : "stopped";
                         nodeInfo["memory_used"] = (int)node->getMemoryUsage();
                         nodeInfo["key_count"] = (int)node->getKeyCount();
+                        nodeInfo["maxmemory_policy"] = evictionPolicyName(node->getEvictionPolicy());
                         
                         // Add ISO timestamp (current time for now)
                         auto now = std::chrono::system_clock::now();
@@ -163,8 +231,10 @@ int main() {
         std::cout << "API Endpoints:\n";
         std::cout << "  POST /node/start   - Create tenant node\n";
         std::cout << "  POST /node/execute - Execute Redis command\n";
+        std::cout << "  POST /node/execute_batch - Execute a command array\n";
         std::cout << "  POST /node/stop    - Stop node\n";
-        std::cout << "  GET  /node/list    - List all nodes\n\n";
+        std::cout << "  GET  /node/list    - List all nodes\n";
+        std::cout << "Each tenant node also speaks RESP on its own port (redis-cli -p <port>)\n\n";
 
         app().run();
 
@@ -108,6 +108,12 @@ export const api = {
     }).then((result) => {
       return { result: result as unknown as string };
     }),
+
+  executeBatch: (tenantId: string, commands: string[], atomic = false) =>
+    gatewayFetch<{ tenant_id: string; replies: string[] }>('/api/nodes/execute_batch', {
+      method: 'POST',
+      body: JSON.stringify({ tenant_id: tenantId, commands, atomic }),
+    }),
 };
 
 export default api;
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "NodeClient.h"
+#include "../common/RespParser.h"
+#include <iostream>
+#include <trantor/net/InetAddress.h>
+
+NodeClient::NodeClient(trantor::EventLoop* loop, const std::string& address, int port,
+                       std::chrono::milliseconds replyTimeout)
+    : loop_(loop), replyTimeout_(replyTimeout) {
+    client_ = std::make_shared<trantor::TcpClient>(
+        loop_, trantor::InetAddress(address, static_cast<uint16_t>(port)), "NodeClient");
+}
+
+NodeClient::~NodeClient() {
+    if (timeoutTimer_) {
+        loop_->invalidateTimer(timeoutTimer_);
+    }
+}
+
+void NodeClient::connect() {
+    std::weak_ptr<NodeClient> weak = shared_from_this();
+
+    client_->setConnectionCallback([weak](const trantor::TcpConnectionPtr& conn) {
+        auto self = weak.lock();
+        if (!self) return;
+        if (conn->connected()) {
+            conn->setTcpNoDelay(true);
+            self->conn_ = conn;
+            if (!self->unsent_.empty()) {
+                conn->send(std::move(self->unsent_));
+                self->unsent_.clear();
+            }
+        } else {
+            self->conn_.reset();
+            self->fail("-ERR node connection lost\r\n");
+        }
+    });
+    client_->setConnectionErrorCallback([weak]() {
+        if (auto self = weak.lock()) {
+            self->fail("-ERR failed to connect to Redis node\r\n");
+        }
+    });
+    client_->setMessageCallback([weak](const trantor::TcpConnectionPtr&, trantor::MsgBuffer* buffer) {
+        if (auto self = weak.lock()) {
+            self->onMessage(buffer);
+        }
+    });
+
+    auto interval = std::chrono::duration<double>(replyTimeout_).count() / 4;
+    timeoutTimer_ = loop_->runEvery(interval, [weak]() {
+        if (auto self = weak.lock()) {
+            self->checkTimeout();
+        }
+    });
+
+    client_->connect();
+}
+
+void NodeClient::send(std::string&& request, size_t replyCount, ReplyCallback done) {
+    if (broken_) {
+        done("-ERR node connection lost\r\n");
+        return;
+    }
+    pending_.push_back(Pending{replyCount, std::string(), std::move(done), std::chrono::steady_clock::now()});
+    if (conn_) {
+        conn_->send(std::move(request));
+    } else {
+        unsent_ += request;
+    }
+}
+
+void NodeClient::onMessage(trantor::MsgBuffer* buffer) {
+    while (buffer->readableBytes() > 0) {
+        if (pending_.empty()) {
+            // Nothing was asked for; the stream can no longer be trusted
+            fail("-ERR unexpected reply from Redis node\r\n");
+            return;
+        }
+
+        size_t consumed = 0;
+        RespParser::Status st = RespParser::scanReply(buffer->peek(), buffer->readableBytes(), consumed);
+        if (st == RespParser::Incomplete) return;
+        if (st == RespParser::Error) {
+            fail("-ERR invalid reply from Redis node\r\n");
+            return;
+        }
+
+        Pending& front = pending_.front();
+        front.replies.append(buffer->peek(), consumed);
+        buffer->retrieve(consumed);
+        if (--front.remaining == 0) {
+            Pending done = std::move(front);
+            pending_.pop_front();
+            done.done(std::move(done.replies));
+        }
+    }
+}
+
+void NodeClient::checkTimeout() {
+    if (pending_.empty()) return;
+    if (std::chrono::steady_clock::now() - pending_.front().sentAt > replyTimeout_) {
+        std::cerr << "[Router] Redis node did not reply in time, dropping connection\n";
+        fail("-ERR Redis node timed out\r\n");
+    }
+}
+
+void NodeClient::fail(const std::string& error) {
+    broken_ = true;
+    unsent_.clear();
+    if (conn_) {
+        conn_->forceClose();
+        conn_.reset();
+    }
+
+    // Callbacks may queue new requests; they go to a fresh client since this one is broken
+    std::deque<Pending> failed;
+    failed.swap(pending_);
+    for (auto& p : failed) {
+        p.done(std::string(error));
+    }
+}
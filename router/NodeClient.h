@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <trantor/net/EventLoop.h>
+#include <trantor/net/TcpClient.h>
+
+// Pipelined RESP connection to one tenant node.
+//
+// A NodeClient belongs to the IO loop it was created on and must only be used
+// from that loop's thread, so it needs no locking. Requests are written as soon
+// as they are queued (or once the connection is up) and their replies are
+// matched back in order. If the node closes the connection or a reply takes
+// longer than the reply timeout, every outstanding request fails with an
+// error reply and the client is marked broken so callers open a new one.
+class NodeClient : public std::enable_shared_from_this<NodeClient> {
+public:
+    // Receives the node's raw RESP replies, concatenated
+    using ReplyCallback = std::function<void(std::string&&)>;
+
+    // Generous on purpose: replies are ordered, so the timeout is measured
+    // from when a request was sent, queueing behind slower ones included, and
+    // hitting it fails every request on the connection
+    static constexpr std::chrono::milliseconds DEFAULT_REPLY_TIMEOUT{30000};
+
+    NodeClient(trantor::EventLoop* loop, const std::string& address, int port,
+               std::chrono::milliseconds replyTimeout = DEFAULT_REPLY_TIMEOUT);
+    ~NodeClient();
+
+    void connect();
+
+    // Sends request, which holds replyCount RESP commands, and calls done once
+    // all of their replies have arrived
+    void send(std::string&& request, size_t replyCount, ReplyCallback done);
+
+    bool broken() const { return broken_; }
+
+private:
+    struct Pending {
+        size_t remaining;
+        std::string replies;
+        ReplyCallback done;
+        std::chrono::steady_clock::time_point sentAt;
+    };
+
+    trantor::EventLoop* loop_;
+    std::chrono::milliseconds replyTimeout_;
+    std::shared_ptr<trantor::TcpClient> client_;
+    trantor::TcpConnectionPtr conn_;
+    trantor::TimerId timeoutTimer_ = 0;   // 0 until connect() starts it
+    std::string unsent_;            // requests queued before the connection came up
+    std::deque<Pending> pending_;
+    bool broken_ = false;
+
+    void onMessage(trantor::MsgBuffer* buffer);
+    void checkTimeout();
+    void fail(const std::string& error);
+};
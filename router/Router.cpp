@@ -1,11 +1,20 @@
 #include "Router.h"
+#include "../config/config.h"
+#include "../common/RespParser.h"
+#include "../common/CommandTable.h"
 #include <iostream>
-#include <sstream>
+#include <algorithm>
 #include <drogon/drogon.h>
 #include <curl/curl.h>
 
 using namespace drogon;
-using namespace sw::redis;
+
+// Verified keys are trusted for API_KEY_TTL; rejected ones are remembered for
+// API_KEY_NEGATIVE_TTL so a bad key cannot hammer the backend
+static const std::chrono::seconds API_KEY_TTL(30);
+static const std::chrono::seconds API_KEY_NEGATIVE_TTL(5);
+static const size_t MAX_CACHED_KEYS = 100000;
+static const double BACKEND_TIMEOUT_SEC = 5.0;
 
 // Callback for CURL response
 static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
@@ -14,10 +23,19 @@ static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* use
 }
 
 Router::Router(const std::string& backendUrl, int routerPort)
-    : backendUrl_(backendUrl), routerPort_(routerPort) {}
+    : backendUrl_(backendUrl), routerPort_(routerPort),
+      nodeReplyTimeout_(std::max(100, EnvLoader::getInt("ROUTER_NODE_REPLY_TIMEOUT_MS",
+                                                        static_cast<int>(NodeClient::DEFAULT_REPLY_TIMEOUT.count())))) {
+    routePoller_ = std::make_unique<RoutePoller>(
+        routes_,
+        [this](const std::string& path) { return backendGet(path); },
+        std::chrono::milliseconds(std::max(100, EnvLoader::getInt("ROUTER_ROUTES_POLL_MS", 2000))),
+        std::chrono::seconds(std::max(1, EnvLoader::getInt("ROUTER_ROUTES_RESYNC_SEC", 60))));
+}
 
 void Router::start() {
     std::cout << "[Router] Starting on port " << routerPort_ << "...\n";
+    routePoller_->start();
     
     // Setup HTTP server for Redis protocol
     app().registerHandler(
@@ -34,32 +52,33 @@ void Router::start() {
             }
 
             // Verify API key and get tenant ID
-            std::string tenantId = verifyApiKey(apiKey);
-            if (tenantId.empty()) {
-                auto resp = HttpResponse::newHttpResponse();
-                resp->setStatusCode(k401Unauthorized);
-                resp->setBody("{\"error\":\"Invalid API key\"}");
-                callback(resp);
-                return;
-            }
+            verifyApiKey(apiKey, [this, req, callback = std::move(callback)](const std::string& tenantId) {
+                if (tenantId.empty()) {
+                    auto resp = HttpResponse::newHttpResponse();
+                    resp->setStatusCode(k401Unauthorized);
+                    resp->setBody("{\"error\":\"Invalid API key\"}");
+                    callback(resp);
+                    return;
+                }
 
-            // Get Redis command from body
-            std::string command = std::string(req->getBody());
-            if (command.empty()) {
-                auto resp = HttpResponse::newHttpResponse();
-                resp->setStatusCode(k400BadRequest);
-                resp->setBody("{\"error\":\"Empty command\"}");
-                callback(resp);
-                return;
-            }
+                // Get Redis command from body
+                std::string command = std::string(req->getBody());
+                if (command.empty()) {
+                    auto resp = HttpResponse::newHttpResponse();
+                    resp->setStatusCode(k400BadRequest);
+                    resp->setBody("{\"error\":\"Empty command\"}");
+                    callback(resp);
+                    return;
+                }
 
-            // Forward to tenant's Redis node
-            std::string result = forwardCommand(tenantId, command);
-            
-            auto resp = HttpResponse::newHttpResponse();
-            resp->setStatusCode(k200OK);
-            resp->setBody(result);
-            callback(resp);
+                // Forward to tenant's Redis node
+                forwardCommand(tenantId, std::move(command), [callback](std::string&& result) {
+                    auto resp = HttpResponse::newHttpResponse();
+                    resp->setStatusCode(k200OK);
+                    resp->setBody(std::move(result));
+                    callback(resp);
+                });
+            });
         },
         {Post}
     );
@@ -73,30 +92,124 @@ void Router::start() {
     app().run();
 }
 
-std::string Router::verifyApiKey(const std::string& apiKey) {
+void Router::verifyApiKey(const std::string& apiKey, VerifyCallback done) {
     // Check cache first
-    auto it = apiKeyCache_.find(apiKey);
-    if (it != apiKeyCache_.end()) {
-        return it->second;
+    {
+        KeyCacheShard& shard = keyCacheShard(apiKey);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.keys.find(apiKey);
+        if (it != shard.keys.end() && it->second.expiresAt > std::chrono::steady_clock::now()) {
+            if (!it->second.referenced.load(std::memory_order_relaxed)) {
+                it->second.referenced.store(true, std::memory_order_relaxed);
+            }
+            std::string tenantId = it->second.tenantId;
+            lock.unlock();
+            done(tenantId);
+            return;
+        }
     }
 
-    // Call backend API
-    std::string tenantId = callBackendVerify(apiKey);
-    if (!tenantId.empty()) {
-        apiKeyCache_[apiKey] = tenantId;
+    // Concurrent misses on one key share a single backend request
+    trantor::EventLoop* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    {
+        std::lock_guard<std::mutex> lock(verifyMutex_);
+        auto& waiters = pendingVerifies_[apiKey];
+        waiters.push_back(Waiter{loop, std::move(done)});
+        if (waiters.size() > 1) {
+            return;
+        }
     }
-    
-    return tenantId;
+
+    // One client per IO thread; never destroyed, as the loop goes away before thread-locals do
+    thread_local HttpClientPtr* backend = new HttpClientPtr(HttpClient::newHttpClient(backendUrl_, loop));
+
+    auto req = HttpRequest::newHttpRequest();
+    req->setMethod(Get);
+    req->setPath("/api/verify");
+    req->setParameter("key", apiKey);
+
+    (*backend)->sendRequest(req, [this, apiKey](ReqResult result, const HttpResponsePtr& resp) {
+        if (result != ReqResult::Ok || !resp) {
+            std::cerr << "[Router] Backend API call failed\n";
+            finishVerify(apiKey, "", false);
+            return;
+        }
+        if (resp->getStatusCode() == k401Unauthorized) {
+            finishVerify(apiKey, "", true);
+            return;
+        }
+
+        auto json = resp->getJsonObject();
+        if (resp->getStatusCode() != k200OK || !json || !json->isMember("tenant_id")) {
+            std::cerr << "[Router] Unexpected backend response: " << resp->getStatusCode() << "\n";
+            finishVerify(apiKey, "", false);
+            return;
+        }
+        finishVerify(apiKey, (*json)["tenant_id"].asString(), true);
+    }, BACKEND_TIMEOUT_SEC);
 }
 
-std::string Router::callBackendVerify(const std::string& apiKey) {
+Router::KeyCacheShard& Router::keyCacheShard(const std::string& apiKey) {
+    return keyCache_[std::hash<std::string>()(apiKey) % KEY_CACHE_SHARDS];
+}
+
+void Router::finishVerify(const std::string& apiKey, const std::string& tenantId, bool cache) {
+    if (cache) {
+        auto now = std::chrono::steady_clock::now();
+        KeyCacheShard& shard = keyCacheShard(apiKey);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (!shard.keys.count(apiKey)) {
+            // CLOCK: the hand drops expired keys and keys not hit since it
+            // last passed, and gives hit ones another lap
+            while (shard.keys.size() >= MAX_CACHED_KEYS / KEY_CACHE_SHARDS && !shard.clock.empty()) {
+                std::string victim = std::move(shard.clock.front());
+                shard.clock.pop_front();
+                auto it = shard.keys.find(victim);
+                if (it == shard.keys.end()) {
+                    continue;
+                }
+                if (it->second.expiresAt > now && it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+                    shard.clock.push_back(std::move(victim));
+                } else {
+                    shard.keys.erase(it);
+                }
+            }
+            shard.clock.push_back(apiKey);
+        }
+        CachedKey& entry = shard.keys[apiKey];
+        entry.tenantId = tenantId;
+        entry.expiresAt = now + (tenantId.empty() ? API_KEY_NEGATIVE_TTL : API_KEY_TTL);
+    }
+
+    std::vector<Waiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(verifyMutex_);
+        auto it = pendingVerifies_.find(apiKey);
+        if (it == pendingVerifies_.end()) {
+            return;
+        }
+        waiters = std::move(it->second);
+        pendingVerifies_.erase(it);
+    }
+
+    // Each request continues on the loop it arrived on
+    for (auto& waiter : waiters) {
+        if (waiter.loop) {
+            waiter.loop->queueInLoop([done = std::move(waiter.done), tenantId]() { done(tenantId); });
+        } else {
+            waiter.done(tenantId);
+        }
+    }
+}
+
+std::string Router::backendGet(const std::string& path) {
     CURL* curl = curl_easy_init();
     if (!curl) {
         std::cerr << "[Router] Failed to init CURL\n";
         return "";
     }
 
-    std::string url = backendUrl_ + "/api/verify?key=" + apiKey;
+    std::string url = backendUrl_ + path;
     std::string response;
 
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
@@ -112,93 +225,99 @@ std::string Router::callBackendVerify(const std::string& apiKey) {
         return "";
     }
 
-    // Parse JSON response: {"tenant_id":"..."}
-    size_t pos = response.find("\"tenant_id\":\"");
-    if (pos != std::string::npos) {
-        pos += 13; // Length of "tenant_id":""
-        size_t end = response.find("\"", pos);
-        if (end != std::string::npos) {
-            return response.substr(pos, end - pos);
+    return response;
+}
+
+std::shared_ptr<NodeClient> Router::nodeClient(const std::string& address, int port) {
+    // Never destroyed, as the loop goes away before thread-locals do
+    thread_local auto* clients = new std::unordered_map<std::string, std::shared_ptr<NodeClient>>();
+
+    std::string nodeKey = address + ":" + std::to_string(port);
+    auto& client = (*clients)[nodeKey];
+    if (!client || client->broken()) {
+        client = std::make_shared<NodeClient>(trantor::EventLoop::getEventLoopOfCurrentThread(), address, port,
+                                              nodeReplyTimeout_);
+        client->connect();
+        std::cout << "[Router] Connecting to Redis node " << nodeKey << "\n";
+    }
+    return client;
+}
+
+// Checks that request holds only complete commands and counts them, so the
+// node's replies can be matched without decoding them. Returns an error reply
+// if the request cannot be forwarded as is.
+static std::string frameCommands(std::string& request, size_t& count) {
+    // An inline command may come without its line ending
+    if (!request.empty() && request.back() != '\n') {
+        request += "\r\n";
+    }
+
+    std::vector<std::string_view> argv;
+    size_t pos = 0;
+    count = 0;
+    while (pos < request.size()) {
+        size_t consumed = 0, needed = 0;
+        const char* error = nullptr;
+        RespParser::Status st = RespParser::parse(request.data() + pos, request.size() - pos,
+                                                  consumed, argv, needed, error);
+        if (st == RespParser::Incomplete) {
+            return "-ERR Protocol error: incomplete command\r\n";
         }
+        if (st == RespParser::Error) {
+            return error;
+        }
+
+        pos += consumed;
+        if (argv.empty()) {
+            continue;  // blank line, the node sends nothing back
+        }
+        // The node connection is shared, so nobody gets to close it
+        if (CommandTable::is(argv[0], CMD_QUIT)) {
+            return "-ERR QUIT is not supported over HTTP\r\n";
+        }
+        count++;
     }
 
+    if (count == 0) {
+        return "-ERR empty command\r\n";
+    }
     return "";
 }
 
-std::shared_ptr<Redis> Router::getRedisConnection(const std::string& tenantId, int port) {
-    auto it = redisConnections_.find(tenantId);
-    if (it != redisConnections_.end()) {
-        return it->second;
+void Router::forwardCommand(const std::string& tenantId, std::string command, ReplyCallback done) {
+    size_t count = 0;
+    std::string error = frameCommands(command, count);
+    if (!error.empty()) {
+        done(std::move(error));
+        return;
     }
 
-    // Create new connection
-    ConnectionOptions opts;
-    opts.host = "127.0.0.1";
-    opts.port = port;
-    opts.socket_timeout = std::chrono::milliseconds(100);
-
-    try {
-        auto redis = std::make_shared<Redis>(opts);
-        redisConnections_[tenantId] = redis;
-        
-        std::cout << "[Router] Connected to Redis node for tenant " << tenantId << " on port " << port << "\n";
-        
-        return redis;
-    } catch (const std::exception& e) {
-        std::cerr << "[Router] Failed to connect to Redis: " << e.what() << "\n";
-        return nullptr;
+    NodeRoute route;
+    if (routes_.lookup(tenantId, route)) {
+        sendToNode(route, std::move(command), count, std::move(done));
+        return;
     }
-}
 
-std::string Router::forwardCommand(const std::string& tenantId, const std::string& command) {
-    try {
-        // TODO: Get port from backend API /api/tenants/{tenantId}
-        // For now, use default port 6379
-        int port = 6379;
-        
-        auto redis = getRedisConnection(tenantId, port);
-        if (!redis) {
-            return "-ERR failed to connect to Redis node\r\n";
-        }
-        
-        // Parse command (simple implementation)
-        // Format: "SET key value" or "GET key"
-        std::istringstream iss(command);
-        std::string cmd;
-        iss >> cmd;
-        
-        if (cmd == "SET") {
-            std::string key, value;
-            iss >> key;
-            // Read the rest as value (may contain spaces)
-            std::getline(iss, value);
-            // Trim leading space
-            if (!value.empty() && value[0] == ' ') {
-                value = value.substr(1);
-            }
-            redis->set(key, value);
-            return "+OK\r\n";
-        } else if (cmd == "GET") {
-            std::string key;
-            iss >> key;
-            auto val = redis->get(key);
-            if (val) {
-                return "$" + std::to_string(val->size()) + "\r\n" + *val + "\r\n";
+    // A tenant created since the last poll gets one immediate poll, without blocking this loop
+    trantor::EventLoop* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    routePoller_->refreshAsync([this, loop, tenantId, command, count, done]() {
+        loop->queueInLoop([this, tenantId, command, count, done]() {
+            NodeRoute route;
+            if (!routes_.lookup(tenantId, route)) {
+                done("-ERR no node assigned to tenant\r\n");
+                return;
             }
-            return "$-1\r\n";
-        } else if (cmd == "DEL") {
-            std::string key;
-            iss >> key;
-            long long count = redis->del(key);
-            return ":" + std::to_string(count) + "\r\n";
-        } else if (cmd == "PING") {
-            return "+PONG\r\n";
-        }
-        
-        return "-ERR unknown command '" + cmd + "'\r\n";
-        
-    } catch (const std::exception& e) {
-        std::cerr << "[Router] Error forwarding command: " << e.what() << "\n";
-        return "-ERR " + std::string(e.what()) + "\r\n";
+            sendToNode(route, std::string(command), count, done);
+        });
+    });
+}
+
+void Router::sendToNode(const NodeRoute& route, std::string&& request, size_t commandCount, ReplyCallback done) {
+    if (route.address.empty()) {
+        done("-ERR failed to connect to Redis node\r\n");
+        return;
     }
-}
\ No newline at end of file
+
+    // The commands go out in one write and the node's replies come back as is
+    nodeClient(route.address, route.port)->send(std::move(request), commandCount, std::move(done));
+}
@@ -1,12 +1,29 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <functional>
+#include <vector>
 #include <unordered_map>
-#include <sw/redis++/redis++.h>
 #include <drogon/HttpClient.h>
+#include "NodeClient.h"
+#include "../common/RoutingTable.h"
 
+// HTTP front end for tenant nodes. Nothing on the request path blocks a Drogon
+// IO thread: keys are verified with an async HttpClient, commands go to the
+// node over a pipelined NodeClient, and each step continues in a callback on
+// the loop that received the request.
 class Router {
 public:
+    // Receives the tenant ID for a key, or "" if the key was rejected
+    using VerifyCallback = std::function<void(const std::string&)>;
+    // Receives the RESP reply to forward to the client
+    using ReplyCallback = NodeClient::ReplyCallback;
+
     Router(const std::string& backendUrl, int routerPort);
     ~Router() = default;
 
@@ -14,24 +31,61 @@ public:
     void start();
 
     // Verify API key with backend
-    std::string verifyApiKey(const std::string& apiKey);
+    void verifyApiKey(const std::string& apiKey, VerifyCallback done);
 
-    // Forward Redis command to tenant's node
-    std::string forwardCommand(const std::string& tenantId, const std::string& command);
+    // Forward Redis commands to tenant's node. command holds one or more RESP
+    // multibulk or inline commands; they are sent to the node in one write and
+    // done receives the node's replies verbatim.
+    void forwardCommand(const std::string& tenantId, std::string command, ReplyCallback done);
 
 private:
+    struct CachedKey {
+        std::string tenantId;     // "" for a key the backend rejected
+        std::chrono::steady_clock::time_point expiresAt;
+        std::atomic<bool> referenced{false};   // hit since the clock hand last passed it
+    };
+
+    // One slice of the key cache, bounded by CLOCK eviction so an insert
+    // evicts in amortized O(1) instead of scanning the cache
+    struct KeyCacheShard {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string, CachedKey> keys;
+        std::deque<std::string> clock;   // insertion order; the front is the hand
+    };
+
+    static const size_t KEY_CACHE_SHARDS = 16;
+
+    struct Waiter {
+        trantor::EventLoop* loop;
+        VerifyCallback done;
+    };
+
     std::string backendUrl_;
     int routerPort_;
-    
-    // Cache: API Key -> Tenant ID
-    std::unordered_map<std::string, std::string> apiKeyCache_;
-    
-    // Cache: Tenant ID -> Redis connection
-    std::unordered_map<std::string, std::shared_ptr<sw::redis::Redis>> redisConnections_;
-    
-    // Get or create Redis connection for tenant
-    std::shared_ptr<sw::redis::Redis> getRedisConnection(const std::string& tenantId, int port);
-    
-    // Call backend API to verify key
-    std::string callBackendVerify(const std::string& apiKey);
-};
\ No newline at end of file
+    std::chrono::milliseconds nodeReplyTimeout_;   // ROUTER_NODE_REPLY_TIMEOUT_MS
+
+    // Cache: API Key -> Tenant ID, shared by all IO threads and sharded so
+    // that a miss being stored only blocks hits on one shard
+    KeyCacheShard keyCache_[KEY_CACHE_SHARDS];
+
+    // Keys with a backend request in flight and the requests waiting on them
+    std::mutex verifyMutex_;
+    std::unordered_map<std::string, std::vector<Waiter>> pendingVerifies_;
+
+    // Tenant -> node placement, kept current by routePoller_
+    RoutingTable routes_;
+    std::unique_ptr<RoutePoller> routePoller_;
+
+    // This IO thread's connection to a node, opened on first use
+    std::shared_ptr<NodeClient> nodeClient(const std::string& address, int port);
+
+    KeyCacheShard& keyCacheShard(const std::string& apiKey);
+
+    // Called on the IO thread that asked for apiKey
+    void finishVerify(const std::string& apiKey, const std::string& tenantId, bool cache);
+
+    void sendToNode(const NodeRoute& route, std::string&& request, size_t commandCount, ReplyCallback done);
+
+    // GET backendUrl_ + path; returns the body, or "" on failure
+    std::string backendGet(const std::string& path);
+};
@@ -20,6 +20,7 @@
     #include <errno.h>
     #include <curl/curl.h>
     #include <cstring>
+    #include <csignal>
     #define SOCKET int
     #define INVALID_SOCKET -1
     #define SOCKET_ERROR -1
@@ -35,7 +36,26 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
 #include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+
+#include "../common/RespParser.h"
+#include "../common/RoutingTable.h"
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <fcntl.h>
+    #include <netinet/tcp.h>
+    #include <strings.h>
+#endif
 
 using namespace std;
 
@@ -43,17 +63,35 @@ const int ROUTER_PORT = 6300;
 const string BACKEND_API_HOST = "backend";
 const int BACKEND_API_PORT = 5500;
 
+// Proxy event loops; ROUTER_PROXY_THREADS overrides (Linux only)
+const int DEFAULT_PROXY_THREADS = 2;
+
+// Persistent node connections per tenant node and proxy loop;
+// ROUTER_UPSTREAM_POOL overrides, 0 gives every client its own spliced connection
+const int DEFAULT_UPSTREAM_POOL = 4;
+int upstreamPoolSize = 0;
+
+// Tenant placement is polled from the backend every ROUTER_ROUTES_POLL_MS,
+// with a full resync every ROUTER_ROUTES_RESYNC_SEC
+const int DEFAULT_ROUTES_POLL_MS = 2000;
+const int DEFAULT_ROUTES_RESYNC_SEC = 60;
+// How long a client of a tenant missing from the table waits on an immediate poll
+const chrono::milliseconds ROUTE_MISS_WAIT(1000);
+
 atomic<bool> shuttingDown(false);
 
+int envInt(const char* name, int defaultValue) {
+    const char* val = getenv(name);
+    return val ? atoi(val) : defaultValue;
+}
+
 struct TenantInfo {
     string tenantId;
     string host;
-    int port;
+    int port = 0;
+    string address;  // numeric IPv4 address of host
 };
 
-unordered_map<string, TenantInfo> apiKeyCache;
-mutex cacheMutex;
-
 // HTTP GET - Platform specific implementations
 #ifdef _WIN32
 string httpGet(const string& host, int port, const string& path) {
@@ -158,58 +196,964 @@ string extractTenantId(const string& json) {
     return json.substr(start, end - start);
 }
 
-bool verifyApiKey(const string& apiKey, TenantInfo& tenantInfo) {
-    {
-        lock_guard<mutex> lock(cacheMutex);
-        auto it = apiKeyCache.find(apiKey);
-        if (it != apiKeyCache.end()) {
-            tenantInfo = it->second;
-            cout << "[Router] Cache hit for API key\n";
-            return true;
-        }
-    }
+enum class KeyLookup { Valid, Invalid, BackendError };
 
+// Asks the backend who owns apiKey. Only a definite "invalid key" answer is
+// Invalid; no answer or an unexpected one is a BackendError and is not cached.
+KeyLookup fetchTenant(const string& apiKey, TenantInfo& tenantInfo) {
     string path = "/api/verify?key=" + apiKey;
-    cout << "[Router] Calling Backend API: GET " << path << "\n";
-
     string response = httpGet(BACKEND_API_HOST, BACKEND_API_PORT, path);
 
     if (response.empty()) {
         cerr << "[Router] Backend API call failed\n";
-        return false;
+        return KeyLookup::BackendError;
     }
 
-    cout << "[Router] Backend response: " << response << "\n";
-
     string tenantId = extractTenantId(response);
     if (tenantId.empty()) {
-        cerr << "[Router] Invalid API key\n";
-        return false;
+        if (response.find("invalid key") != string::npos) {
+            return KeyLookup::Invalid;
+        }
+        cerr << "[Router] Unexpected backend response: " << response.substr(0, 200) << "\n";
+        return KeyLookup::BackendError;
     }
 
     tenantInfo.tenantId = tenantId;
-    tenantInfo.host = "redis-node1";
-    
-    // Map tenant to port (should query from backend in production)
-    if (tenantId.find("0000") != string::npos) {
-        tenantInfo.port = 6379;
-    } else if (tenantId.find("0001") != string::npos) {
-        tenantInfo.port = 6380;
-    } else if (tenantId.find("0002") != string::npos) {
-        tenantInfo.port = 6381;
+    return KeyLookup::Valid;
+}
+
+// API-key cache. Sharded maps of immutable entries behind shared_mutexes, so a
+// hit only takes a shared lock and never waits on the backend:
+//   - entries younger than API_KEY_TTL are served as is;
+//   - older ones are still served, up to API_KEY_MAX_STALE, while one
+//     background refresh runs (revoked keys stop working within about a TTL);
+//   - a key the backend rejects is remembered for API_KEY_NEGATIVE_TTL;
+//   - concurrent misses on one key share a single backend request;
+//   - each shard holds at most its part of ROUTER_KEY_CACHE_SIZE entries and
+//     evicts with CLOCK (second chance for entries hit since the last sweep).
+const chrono::seconds API_KEY_TTL(30);
+const chrono::seconds API_KEY_MAX_STALE(120);
+const chrono::seconds API_KEY_NEGATIVE_TTL(5);
+const int DEFAULT_KEY_CACHE_SIZE = 100000;
+const size_t KEY_CACHE_SHARDS = 16;
+
+class ApiKeyCache {
+public:
+    explicit ApiKeyCache(size_t capacity)
+        : shardCapacity_(max<size_t>(1, capacity / KEY_CACHE_SHARDS)) {
+        refresher_ = thread(&ApiKeyCache::refreshLoop, this);
+        refresher_.detach();
+    }
+
+    bool verify(const string& apiKey, TenantInfo& tenantInfo) {
+        Shard& shard = shardFor(apiKey);
+        auto now = chrono::steady_clock::now();
+
+        {
+            shared_lock<shared_mutex> lock(shard.mtx);
+            auto it = shard.entries.find(apiKey);
+            if (it != shard.entries.end()) {
+                const EntryPtr& entry = it->second;
+                auto age = now - entry->fetchedAt;
+                if (!entry->valid && age < API_KEY_NEGATIVE_TTL) {
+                    return false;
+                }
+                if (entry->valid && age < API_KEY_MAX_STALE) {
+                    if (!entry->referenced.load(memory_order_relaxed)) {
+                        entry->referenced.store(true, memory_order_relaxed);
+                    }
+                    if (age >= API_KEY_TTL && !entry->refreshing.exchange(true)) {
+                        scheduleRefresh(apiKey);
+                    }
+                    tenantInfo = entry->tenant;
+                    return true;
+                }
+            }
+        }
+
+        return lookupShared(shard, apiKey, tenantInfo);
+    }
+
+private:
+    struct Entry {
+        TenantInfo tenant;
+        bool valid;
+        chrono::steady_clock::time_point fetchedAt;
+        atomic<bool> referenced{false};
+        atomic<bool> refreshing{false};
+    };
+    using EntryPtr = shared_ptr<Entry>;
+
+    // One backend request that concurrent misses on the same key wait for
+    struct Flight {
+        mutex mtx;
+        condition_variable cv;
+        bool done = false;
+        KeyLookup result = KeyLookup::BackendError;
+        TenantInfo tenant;
+    };
+
+    struct Shard {
+        shared_mutex mtx;
+        unordered_map<string, EntryPtr> entries;
+        deque<string> clock;                       // insertion order for eviction
+        unordered_map<string, shared_ptr<Flight>> flights;
+    };
+
+    Shard shards_[KEY_CACHE_SHARDS];
+    size_t shardCapacity_;
+
+    thread refresher_;
+    mutex refreshMutex_;
+    condition_variable refreshCv_;
+    deque<string> refreshQueue_;
+
+    Shard& shardFor(const string& apiKey) {
+        return shards_[hash<string>()(apiKey) % KEY_CACHE_SHARDS];
+    }
+
+    bool lookupShared(Shard& shard, const string& apiKey, TenantInfo& tenantInfo) {
+        shared_ptr<Flight> flight;
+        bool leader = false;
+        {
+            unique_lock<shared_mutex> lock(shard.mtx);
+            auto it = shard.flights.find(apiKey);
+            if (it != shard.flights.end()) {
+                flight = it->second;
+            } else {
+                flight = make_shared<Flight>();
+                shard.flights.emplace(apiKey, flight);
+                leader = true;
+            }
+        }
+
+        if (leader) {
+            TenantInfo fetched;
+            KeyLookup result = fetchTenant(apiKey, fetched);
+            store(shard, apiKey, result, fetched);
+            {
+                unique_lock<shared_mutex> lock(shard.mtx);
+                shard.flights.erase(apiKey);
+            }
+            {
+                lock_guard<mutex> lock(flight->mtx);
+                flight->result = result;
+                flight->tenant = fetched;
+                flight->done = true;
+            }
+            flight->cv.notify_all();
+        } else {
+            unique_lock<mutex> lock(flight->mtx);
+            flight->cv.wait(lock, [&flight] { return flight->done; });
+        }
+
+        if (flight->result != KeyLookup::Valid) {
+            return false;
+        }
+        tenantInfo = flight->tenant;
+        return true;
+    }
+
+    void store(Shard& shard, const string& apiKey, KeyLookup result, const TenantInfo& tenant) {
+        if (result == KeyLookup::BackendError) {
+            return;  // keep whatever we had; it ages out on its own
+        }
+
+        auto entry = make_shared<Entry>();
+        entry->tenant = tenant;
+        entry->valid = result == KeyLookup::Valid;
+        entry->fetchedAt = chrono::steady_clock::now();
+
+        unique_lock<shared_mutex> lock(shard.mtx);
+        auto it = shard.entries.find(apiKey);
+        if (it != shard.entries.end()) {
+            it->second = entry;
+            return;
+        }
+
+        while (shard.entries.size() >= shardCapacity_ && !shard.clock.empty()) {
+            string victim = move(shard.clock.front());
+            shard.clock.pop_front();
+            auto vit = shard.entries.find(victim);
+            if (vit == shard.entries.end()) continue;
+            if (vit->second->referenced.exchange(false, memory_order_relaxed)) {
+                shard.clock.push_back(move(victim));
+            } else {
+                shard.entries.erase(vit);
+            }
+        }
+        shard.entries.emplace(apiKey, entry);
+        shard.clock.push_back(apiKey);
+    }
+
+    void scheduleRefresh(const string& apiKey) {
+        {
+            lock_guard<mutex> lock(refreshMutex_);
+            refreshQueue_.push_back(apiKey);
+        }
+        refreshCv_.notify_one();
+    }
+
+    void refreshLoop() {
+        while (!shuttingDown.load()) {
+            string apiKey;
+            {
+                unique_lock<mutex> lock(refreshMutex_);
+                refreshCv_.wait(lock, [this] { return !refreshQueue_.empty(); });
+                apiKey = move(refreshQueue_.front());
+                refreshQueue_.pop_front();
+            }
+
+            TenantInfo fetched;
+            KeyLookup result = fetchTenant(apiKey, fetched);
+            Shard& shard = shardFor(apiKey);
+            if (result == KeyLookup::BackendError) {
+                // Let a later hit retry; the old entry stays until API_KEY_MAX_STALE
+                shared_lock<shared_mutex> lock(shard.mtx);
+                auto it = shard.entries.find(apiKey);
+                if (it != shard.entries.end()) {
+                    it->second->refreshing.store(false);
+                }
+                continue;
+            }
+            store(shard, apiKey, result, fetched);
+        }
+    }
+};
+
+ApiKeyCache& apiKeyCache() {
+    // Never destroyed: the detached refresher may still be waiting on it at exit
+    static ApiKeyCache* cache = new ApiKeyCache(max(1, envInt("ROUTER_KEY_CACHE_SIZE", DEFAULT_KEY_CACHE_SIZE)));
+    return *cache;
+}
+
+bool verifyApiKey(const string& apiKey, TenantInfo& tenantInfo) {
+    return apiKeyCache().verify(apiKey, tenantInfo);
+}
+
+// Never destroyed, like the key cache: detached client threads may still be
+// looking up routes while main() returns
+RoutingTable& routingTable() {
+    static RoutingTable* table = new RoutingTable();
+    return *table;
+}
+
+RoutePoller& routePoller() {
+    static RoutePoller* poller = new RoutePoller(
+        routingTable(),
+        [](const string& path) { return httpGet(BACKEND_API_HOST, BACKEND_API_PORT, path); },
+        chrono::milliseconds(max(100, envInt("ROUTER_ROUTES_POLL_MS", DEFAULT_ROUTES_POLL_MS))),
+        chrono::seconds(max(1, envInt("ROUTER_ROUTES_RESYNC_SEC", DEFAULT_ROUTES_RESYNC_SEC))));
+    return *poller;
+}
+
+// Fills in the node tenantInfo's tenant is placed on. Routes are looked up per
+// connection, not cached with the API key, so a move takes effect for the next
+// client. A tenant created since the last poll gets one immediate poll.
+bool routeTenant(TenantInfo& tenantInfo) {
+    NodeRoute route;
+    if (!routingTable().lookup(tenantInfo.tenantId, route) || route.address.empty()) {
+        routePoller().refreshNow(ROUTE_MISS_WAIT);
+        if (!routingTable().lookup(tenantInfo.tenantId, route) || route.address.empty()) {
+            return false;
+        }
+    }
+    tenantInfo.host = route.host;
+    tenantInfo.port = route.port;
+    tenantInfo.address = route.address;
+    return true;
+}
+
+#ifdef __linux__
+// Event-driven proxy core. Once a client is authenticated its socket pair is
+// handed to one of a few epoll loops, and bytes move in each direction
+// socket -> pipe -> socket with splice(), never entering user space. A FIN is
+// forwarded as shutdown(SHUT_WR) once everything before it has been delivered,
+// so half-closed connections keep receiving replies until the other side ends.
+
+// Pipes are only held while a channel has bytes in flight and go back to a
+// per-loop pool afterwards, so idle connections cost no pipe descriptors.
+const size_t SPLICE_PIPE_SIZE = 256 * 1024;
+const size_t MAX_POOLED_PIPES = 256;
+
+struct SplicePipe {
+    int readFd = -1;
+    int writeFd = -1;
+};
+
+void closePipe(SplicePipe& p) {
+    if (p.readFd >= 0) close(p.readFd);
+    if (p.writeFd >= 0) close(p.writeFd);
+    p = SplicePipe();
+}
+
+struct SpliceChannel {
+    int from;
+    int to;
+    SplicePipe pipe;
+    size_t buffered = 0;   // bytes sitting in the pipe
+    bool eof = false;      // source has sent FIN
+    bool done = false;     // FIN forwarded to the destination
+};
+
+struct ProxySession {
+    SOCKET clientSock;
+    SOCKET tenantSock;
+    SpliceChannel up;      // client -> tenant
+    SpliceChannel down;    // tenant -> client
+
+    ProxySession(SOCKET client, SOCKET tenant) : clientSock(client), tenantSock(tenant) {
+        up.from = down.to = client;
+        up.to = down.from = tenant;
+    }
+
+    ~ProxySession() {
+        closePipe(up.pipe);
+        closePipe(down.pipe);
+        closesocket(clientSock);
+        closesocket(tenantSock);
+    }
+};
+using ProxySessionPtr = shared_ptr<ProxySession>;
+
+// Multiplexed mode (upstreamPoolSize > 0). Instead of one node connection per
+// client, each loop keeps a few persistent connections per tenant node and
+// writes client requests onto them verbatim, twemproxy style. A client always
+// uses the same pool slot, and every upstream queues the client behind each
+// request it carries, so replies are matched back in order.
+const size_t MUX_READ_CHUNK = 16 * 1024;
+const size_t MAX_CLIENT_BACKLOG = 4 * 1024 * 1024;  // unsent reply bytes before a client is paused
+const size_t MAX_CLIENT_INFLIGHT = 1024;            // unanswered requests before a client is paused
+
+struct Upstream;
+
+struct MuxClient {
+    SOCKET sock;
+    uint64_t id;
+    TenantInfo tenant;
+    shared_ptr<Upstream> upstream;
+    vector<char> in;
+    size_t needed = 0;        // buffer size the parser asked for before retrying
+    string out;
+    size_t outOffset = 0;
+    size_t inFlight = 0;      // requests sent upstream and not answered yet
+    string closingReply;      // sent once inFlight drains (QUIT or protocol error)
+    bool eof = false;         // client sent FIN; close once everything is answered
+    bool closing = false;
+    bool paused = false;      // reads stopped until replies drain
+    bool closed = false;
+
+    ~MuxClient() { closesocket(sock); }
+};
+using MuxClientPtr = shared_ptr<MuxClient>;
+
+struct Upstream {
+    SOCKET sock;
+    string nodeKey;           // "host:port"
+    size_t slot;
+    bool connecting = true;
+    bool broken = false;
+    string out;
+    size_t outOffset = 0;
+    vector<char> in;
+    deque<weak_ptr<MuxClient>> waiting;  // sender of each outstanding request
+
+    ~Upstream() { closesocket(sock); }
+};
+using UpstreamPtr = shared_ptr<Upstream>;
+
+struct ProxyLoop {
+    int epollFd = -1;
+    int wakeFd = -1;
+    mutex incomingMutex;
+    vector<ProxySessionPtr> incoming;
+    vector<MuxClientPtr> incomingClients;
+    unordered_map<int, ProxySessionPtr> sessions;  // keyed by both sockets
+    vector<SplicePipe> pipePool;                   // empty pipes ready for reuse
+
+    unordered_map<int, MuxClientPtr> clients;
+    unordered_map<int, UpstreamPtr> upstreams;          // by socket
+    unordered_map<string, vector<UpstreamPtr>> pools;   // by node "host:port"
+};
+
+vector<unique_ptr<ProxyLoop>> proxyLoops;
+
+bool acquirePipe(ProxyLoop& loop, SpliceChannel& ch) {
+    if (!loop.pipePool.empty()) {
+        ch.pipe = loop.pipePool.back();
+        loop.pipePool.pop_back();
+        return true;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        return false;
+    }
+    ch.pipe.readFd = fds[0];
+    ch.pipe.writeFd = fds[1];
+    fcntl(ch.pipe.writeFd, F_SETPIPE_SZ, (int)SPLICE_PIPE_SIZE);  // best effort; default is 64 KB
+    return true;
+}
+
+// Only an empty pipe can be shared; one with bytes left in it is closed
+void releasePipe(ProxyLoop& loop, SpliceChannel& ch) {
+    if (ch.pipe.readFd < 0) return;
+    if (ch.buffered == 0 && loop.pipePool.size() < MAX_POOLED_PIPES) {
+        loop.pipePool.push_back(ch.pipe);
+        ch.pipe = SplicePipe();
     } else {
-        tenantInfo.port = 6379;
+        closePipe(ch.pipe);
+    }
+}
+
+// Moves whatever can move without blocking; false on a socket or pipe error.
+bool pumpChannel(ProxyLoop& loop, SpliceChannel& ch) {
+    const unsigned flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+    while (true) {
+        while (ch.buffered > 0) {
+            ssize_t n = splice(ch.pipe.readFd, nullptr, ch.to, nullptr, ch.buffered, flags);
+            if (n > 0) {
+                ch.buffered -= n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            return n < 0 && errno == EAGAIN;  // destination full: resume on EPOLLOUT
+        }
+
+        if (ch.eof) {
+            releasePipe(loop, ch);
+            if (!ch.done) {
+                shutdown(ch.to, SHUT_WR);
+                ch.done = true;
+            }
+            return true;
+        }
+
+        if (ch.pipe.readFd < 0 && !acquirePipe(loop, ch)) {
+            cerr << "[Router] pipe2() failed: " << errno << "\n";
+            return false;
+        }
+
+        ssize_t n = splice(ch.from, nullptr, ch.pipe.writeFd, nullptr, SPLICE_PIPE_SIZE, flags);
+        if (n > 0) {
+            ch.buffered += n;
+        } else if (n == 0) {
+            ch.eof = true;
+        } else if (errno != EINTR) {
+            releasePipe(loop, ch);
+            return errno == EAGAIN;  // source drained: resume on EPOLLIN
+        }
+    }
+}
+
+void closeSession(ProxyLoop& loop, const ProxySessionPtr& session) {
+    releasePipe(loop, session->up);
+    releasePipe(loop, session->down);
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, session->clientSock, nullptr);
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, session->tenantSock, nullptr);
+    loop.sessions.erase(session->clientSock);
+    loop.sessions.erase(session->tenantSock);
+    cout << "[Router] Client disconnected\n";
+}
+
+// Sends as much of out as the socket takes; false on a socket error.
+bool flushBuffer(SOCKET sock, string& out, size_t& offset) {
+    while (offset < out.size()) {
+        ssize_t n = send(sock, out.data() + offset, out.size() - offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        offset += n;
     }
+    out.clear();
+    offset = 0;
+    return true;
+}
+
+// Appends one recv() worth of bytes; 0 on EOF, -1 on error, -2 when drained.
+ssize_t readChunk(SOCKET sock, vector<char>& in, size_t atLeast) {
+    size_t used = in.size();
+    in.resize(used + max(MUX_READ_CHUNK, atLeast > used ? atLeast - used : 0));
+    while (true) {
+        ssize_t n = recv(sock, in.data() + used, in.size() - used, 0);
+        if (n < 0 && errno == EINTR) continue;
+        in.resize(used + (n > 0 ? n : 0));
+        if (n < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? -2 : -1;
+        }
+        return n;
+    }
+}
+
+void closeClient(ProxyLoop& loop, const MuxClientPtr& client) {
+    client->closed = true;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, client->sock, nullptr);
+    loop.clients.erase(client->sock);
+    cout << "[Router] Client disconnected\n";
+}
+
+void onClientReadable(ProxyLoop& loop, const MuxClientPtr& client);
+
+// Flushes replies and decides whether the client closes or resumes reading.
+void settleClient(ProxyLoop& loop, const MuxClientPtr& client) {
+    if (client->closed) return;
+
+    if (client->closing && client->inFlight == 0 && !client->closingReply.empty()) {
+        client->out += client->closingReply;
+        client->closingReply.clear();
+    }
+    if (!flushBuffer(client->sock, client->out, client->outOffset)) {
+        closeClient(loop, client);
+        return;
+    }
+    if ((client->eof || client->closing) && client->inFlight == 0 && client->out.empty()) {
+        closeClient(loop, client);
+        return;
+    }
+    if (client->paused && client->out.size() - client->outOffset < MAX_CLIENT_BACKLOG &&
+        client->inFlight < MAX_CLIENT_INFLIGHT) {
+        client->paused = false;
+        onClientReadable(loop, client);
+    }
+}
+
+// Answers every request still queued on a dead upstream and retires it.
+void failUpstream(ProxyLoop& loop, const UpstreamPtr& up) {
+    if (up->broken) return;
+    up->broken = true;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, up->sock, nullptr);
+    loop.upstreams.erase(up->sock);
+
+    auto& pool = loop.pools[up->nodeKey];
+    if (up->slot < pool.size() && pool[up->slot] == up) {
+        pool[up->slot].reset();
+    }
+
+    cerr << "[Router] Lost tenant node connection " << up->nodeKey << "\n";
+    vector<MuxClientPtr> touched;
+    for (auto& waiter : up->waiting) {
+        if (auto client = waiter.lock()) {
+            client->out += "-ERR Tenant node unavailable\r\n";
+            client->inFlight--;
+            touched.push_back(client);
+        }
+    }
+    up->waiting.clear();
+    for (auto& client : touched) {
+        settleClient(loop, client);
+    }
+}
+
+UpstreamPtr connectUpstream(ProxyLoop& loop, const TenantInfo& tenant, const string& nodeKey, size_t slot) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) {
+        return nullptr;
+    }
+    auto up = make_shared<Upstream>();
+    up->sock = sock;
+    up->nodeKey = nodeKey;
+    up->slot = slot;
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(tenant.port);
+    inet_pton(AF_INET, tenant.address.c_str(), &addr.sin_addr);
+
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        return nullptr;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = sock;
+    if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, sock, &ev) < 0) {
+        return nullptr;
+    }
+    loop.upstreams[sock] = up;
+    cout << "[Router] Opened pooled connection to " << nodeKey << " (slot " << slot << ")\n";
+    return up;
+}
+
+UpstreamPtr upstreamFor(ProxyLoop& loop, MuxClient& client) {
+    if (client.upstream && !client.upstream->broken) {
+        return client.upstream;
+    }
+
+    string nodeKey = client.tenant.address + ":" + to_string(client.tenant.port);
+    auto& pool = loop.pools[nodeKey];
+    pool.resize(upstreamPoolSize);
+
+    size_t slot = client.id % pool.size();
+    if (!pool[slot]) {
+        pool[slot] = connectUpstream(loop, client.tenant, nodeKey, slot);
+    }
+    client.upstream = pool[slot];
+    return client.upstream;
+}
 
+void flushUpstream(ProxyLoop& loop, const UpstreamPtr& up) {
+    if (up->connecting || up->broken) return;
+    if (!flushBuffer(up->sock, up->out, up->outOffset)) {
+        failUpstream(loop, up);
+    }
+}
+
+// Forwards every complete request in the client's buffer, then reads more.
+void onClientReadable(ProxyLoop& loop, const MuxClientPtr& client) {
+    vector<string_view> argv;
+    UpstreamPtr used;
+
+    while (!client->closing && !client->eof) {
+        if (client->out.size() - client->outOffset >= MAX_CLIENT_BACKLOG ||
+            client->inFlight >= MAX_CLIENT_INFLIGHT) {
+            client->paused = true;  // resumed by settleClient once replies drain
+            break;
+        }
+
+        size_t pos = 0;
+        if (client->in.size() >= client->needed) {
+            client->needed = 0;
+            while (pos < client->in.size() && client->inFlight < MAX_CLIENT_INFLIGHT) {
+                size_t consumed = 0, needed = 0;
+                const char* error = nullptr;
+                auto st = RespParser::parse(client->in.data() + pos, client->in.size() - pos,
+                                            consumed, argv, needed, error);
+                if (st == RespParser::Incomplete) {
+                    client->needed = needed;
+                    break;
+                }
+                if (st == RespParser::Error) {
+                    client->closing = true;
+                    client->closingReply = error;
+                    break;
+                }
+
+                const char* frame = client->in.data() + pos;
+                pos += consumed;
+                if (argv.empty()) continue;
+
+                // QUIT ends this client only; the pooled connection stays open
+                if (argv[0].size() == 4 && strncasecmp(argv[0].data(), "QUIT", 4) == 0) {
+                    client->closing = true;
+                    client->closingReply = "+OK\r\n";
+                    break;
+                }
+
+                UpstreamPtr up = upstreamFor(loop, *client);
+                if (!up) {
+                    client->closing = true;
+                    client->closingReply = "-ERR Tenant node unavailable\r\n";
+                    break;
+                }
+                up->out.append(frame, consumed);
+                up->waiting.push_back(client);
+                client->inFlight++;
+                used = up;
+            }
+            client->in.erase(client->in.begin(), client->in.begin() + pos);
+        }
+        if (client->closing || client->inFlight >= MAX_CLIENT_INFLIGHT) {
+            continue;  // re-checked at the top of the loop
+        }
+
+        ssize_t n = readChunk(client->sock, client->in, client->needed);
+        if (n == -2) break;
+        if (n < 0) {
+            closeClient(loop, client);
+            return;
+        }
+        if (n == 0) client->eof = true;
+    }
+
+    if (client->closing) {
+        client->in.clear();
+    }
+    if (used) {
+        flushUpstream(loop, used);  // every request from this read goes out in one write
+    }
+    settleClient(loop, client);
+}
+
+void onUpstreamEvent(ProxyLoop& loop, const UpstreamPtr& up, uint32_t events) {
+    if (up->connecting && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(up->sock, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            failUpstream(loop, up);
+            return;
+        }
+        up->connecting = false;
+    }
+    if (events & EPOLLERR) {
+        failUpstream(loop, up);
+        return;
+    }
+    flushUpstream(loop, up);
+    if (up->broken || up->connecting) return;
+
+    // Hand each complete reply to the client at the head of the queue
+    vector<MuxClientPtr> touched;
+    bool open = true;
+    while (open) {
+        ssize_t n = readChunk(up->sock, up->in, 0);
+        if (n == -2) break;
+        if (n <= 0) open = false;
+
+        size_t pos = 0;
+        while (pos < up->in.size()) {
+            size_t consumed = 0;
+            auto st = RespParser::scanReply(up->in.data() + pos, up->in.size() - pos, consumed);
+            if (st == RespParser::Incomplete) break;
+            if (st == RespParser::Error || up->waiting.empty()) {
+                open = false;  // out of step with the node; nothing left can be matched
+                break;
+            }
+            if (auto client = up->waiting.front().lock()) {
+                client->out.append(up->in.data() + pos, consumed);
+                client->inFlight--;
+                if (touched.empty() || touched.back() != client) {
+                    touched.push_back(client);
+                }
+            }
+            up->waiting.pop_front();
+            pos += consumed;
+        }
+        up->in.erase(up->in.begin(), up->in.begin() + pos);
+    }
+
+    for (auto& client : touched) {
+        settleClient(loop, client);
+    }
+    if (!open) {
+        failUpstream(loop, up);
+    }
+}
+
+void adoptSessions(ProxyLoop& loop) {
+    uint64_t v;
+    while (read(loop.wakeFd, &v, sizeof(v)) > 0) {
+    }
+
+    vector<ProxySessionPtr> fresh;
+    vector<MuxClientPtr> freshClients;
     {
-        lock_guard<mutex> lock(cacheMutex);
-        apiKeyCache[apiKey] = tenantInfo;
+        lock_guard<mutex> lock(loop.incomingMutex);
+        fresh.swap(loop.incoming);
+        freshClients.swap(loop.incomingClients);
+    }
+
+    for (auto& client : freshClients) {
+        int flags = fcntl(client->sock, F_GETFL, 0);
+        fcntl(client->sock, F_SETFL, flags | O_NONBLOCK);
+        int one = 1;
+        setsockopt(client->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = client->sock;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, client->sock, &ev) < 0) {
+            cerr << "[Router] epoll_ctl failed: " << errno << "\n";
+            continue;
+        }
+        loop.clients[client->sock] = client;
+        onClientReadable(loop, client);  // requests pipelined behind APIKEY
     }
 
-    cout << "[Router] Authenticated tenant: " << tenantId << " -> port " << tenantInfo.port << "\n";
+    for (auto& session : fresh) {
+        bool ok = true;
+        for (SOCKET sock : {session->clientSock, session->tenantSock}) {
+            int flags = fcntl(sock, F_GETFL, 0);
+            fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+            int one = 1;
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // forward small replies at once
+
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = sock;
+            if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, sock, &ev) < 0) {
+                ok = false;
+            }
+            loop.sessions[sock] = session;
+        }
+        if (!ok) {
+            cerr << "[Router] epoll_ctl failed: " << errno << "\n";
+            closeSession(loop, session);
+        }
+    }
+}
+
+void proxyLoop(ProxyLoop& loop) {
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+
+    while (!shuttingDown.load()) {
+        int n = epoll_wait(loop.epollFd, events, MAX_EVENTS, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            cerr << "[Router] epoll_wait failed: " << errno << "\n";
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == loop.wakeFd) {
+                adoptSessions(loop);
+                continue;
+            }
+
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+
+            auto cit = loop.clients.find(fd);
+            if (cit != loop.clients.end()) {
+                MuxClientPtr client = cit->second;
+                if (ev & EPOLLERR) {
+                    closeClient(loop, client);
+                } else {
+                    if (ev & EPOLLOUT) settleClient(loop, client);
+                    if (!client->closed && (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                        onClientReadable(loop, client);
+                    }
+                }
+                continue;
+            }
+
+            auto uit = loop.upstreams.find(fd);
+            if (uit != loop.upstreams.end()) {
+                UpstreamPtr up = uit->second;
+                onUpstreamEvent(loop, up, ev);
+                continue;
+            }
+
+            auto it = loop.sessions.find(fd);
+            if (it == loop.sessions.end()) {
+                continue;  // closed earlier in this batch
+            }
+            ProxySessionPtr session = it->second;
+
+            // Either socket's readiness can unblock either direction, so pump both
+            bool ok = !(ev & EPOLLERR) &&
+                      pumpChannel(loop, session->up) && pumpChannel(loop, session->down);
+            if (!ok || (session->up.done && session->down.done)) {
+                closeSession(loop, session);
+            }
+        }
+    }
+}
+
+bool startProxyLoops() {
+    int count = max(1, envInt("ROUTER_PROXY_THREADS", DEFAULT_PROXY_THREADS));
+    for (int i = 0; i < count; i++) {
+        auto loop = make_unique<ProxyLoop>();
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epollFd < 0 || loop->wakeFd < 0) {
+            cerr << "[Router] Failed to create proxy loop: " << errno << "\n";
+            return false;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = loop->wakeFd;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &ev);
+        proxyLoops.push_back(move(loop));
+    }
+
+    for (auto& loop : proxyLoops) {
+        thread(proxyLoop, ref(*loop)).detach();
+    }
+    upstreamPoolSize = max(0, envInt("ROUTER_UPSTREAM_POOL", DEFAULT_UPSTREAM_POOL));
+    cout << "[Router] " << count << " proxy loop(s) started, ";
+    if (upstreamPoolSize > 0) {
+        cout << upstreamPoolSize << " pooled node connection(s) per tenant node per loop\n";
+    } else {
+        cout << "one spliced node connection per client\n";
+    }
     return true;
 }
 
+ProxyLoop& nextProxyLoop() {
+    static atomic<size_t> nextLoop(0);
+    return *proxyLoops[nextLoop.fetch_add(1) % proxyLoops.size()];
+}
+
+void wakeProxyLoop(ProxyLoop& loop) {
+    uint64_t one = 1;
+    if (write(loop.wakeFd, &one, sizeof(one)) < 0) {
+        cerr << "[Router] Proxy wakeup failed: " << errno << "\n";
+    }
+}
+
+void startProxy(SOCKET clientSock, SOCKET tenantSock) {
+    auto session = make_shared<ProxySession>(clientSock, tenantSock);
+
+    ProxyLoop& loop = nextProxyLoop();
+    {
+        lock_guard<mutex> lock(loop.incomingMutex);
+        loop.incoming.push_back(move(session));
+    }
+    wakeProxyLoop(loop);
+}
+
+void startMuxClient(SOCKET clientSock, const TenantInfo& tenant, const string& pending) {
+    static atomic<uint64_t> nextClientId(0);
+    auto client = make_shared<MuxClient>();
+    client->sock = clientSock;
+    client->id = nextClientId.fetch_add(1);
+    client->tenant = tenant;
+    client->in.assign(pending.begin(), pending.end());
+
+    ProxyLoop& loop = nextProxyLoop();
+    {
+        lock_guard<mutex> lock(loop.incomingMutex);
+        loop.incomingClients.push_back(move(client));
+    }
+    wakeProxyLoop(loop);
+}
+#else
+bool startProxyLoops() {
+    return true;
+}
+
+void startMuxClient(SOCKET, const TenantInfo&, const string&) {
+}
+
+// Fallback for platforms without epoll/splice: one pump thread per direction.
+void startProxy(SOCKET clientSock, SOCKET tenantSock) {
+    thread clientToTenant([clientSock, tenantSock]() {
+        char buf[4096];
+        int n;
+        while ((n = recv(clientSock, buf, sizeof(buf), 0)) > 0) {
+            send(tenantSock, buf, n, 0);
+        }
+        shutdown(tenantSock, SD_SEND);
+    });
+
+    thread tenantToClient([clientSock, tenantSock]() {
+        char buf[4096];
+        int n;
+        while ((n = recv(tenantSock, buf, sizeof(buf), 0)) > 0) {
+            send(clientSock, buf, n, 0);
+        }
+        shutdown(clientSock, SD_SEND);
+    });
+
+    clientToTenant.join();
+    tenantToClient.join();
+
+    closesocket(clientSock);
+    closesocket(tenantSock);
+
+    cout << "[Router] Client disconnected\n";
+}
+#endif
+
 void handleClient(SOCKET clientSock, const string& clientIp) {
     char buffer[4096];
     int bytesReceived = recv(clientSock, buffer, sizeof(buffer) - 1, 0);
@@ -219,8 +1163,11 @@ void handleClient(SOCKET clientSock, const string& clientIp) {
         return;
     }
 
-    buffer[bytesReceived] = '\0';
-    string request(buffer);
+    string request(buffer, bytesReceived);
+
+    // Anything pipelined after the APIKEY line belongs to the tenant
+    size_t lineEnd = request.find('\n');
+    string pending = lineEnd == string::npos ? "" : request.substr(lineEnd + 1);
 
     cout << "[Router] Received from " << clientIp << ": " << request.substr(0, 50) << "...\n";
 
@@ -243,6 +1190,21 @@ void handleClient(SOCKET clientSock, const string& clientIp) {
         return;
     }
 
+    if (!routeTenant(tenantInfo)) {
+        string error = "-ERR No node assigned to tenant\r\n";
+        send(clientSock, error.c_str(), error.length(), 0);
+        closesocket(clientSock);
+        return;
+    }
+
+    if (upstreamPoolSize > 0) {
+        // Node connections come from the proxy loop's pool and are opened on demand
+        string success = "+OK Authenticated. Connected to tenant: " + tenantInfo.tenantId + "\r\n";
+        send(clientSock, success.c_str(), success.length(), 0);
+        startMuxClient(clientSock, tenantInfo, pending);
+        return;
+    }
+
     SOCKET tenantSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (tenantSock == INVALID_SOCKET) {
         string error = "-ERR Failed to connect to tenant node\r\n";
@@ -255,7 +1217,7 @@ void handleClient(SOCKET clientSock, const string& clientIp) {
     memset(&tenantAddr, 0, sizeof(tenantAddr));
     tenantAddr.sin_family = AF_INET;
     tenantAddr.sin_port = htons(tenantInfo.port);
-    inet_pton(AF_INET, tenantInfo.host.c_str(), &tenantAddr.sin_addr);
+    inet_pton(AF_INET, tenantInfo.address.c_str(), &tenantAddr.sin_addr);
 
     if (connect(tenantSock, (sockaddr*)&tenantAddr, sizeof(tenantAddr)) == SOCKET_ERROR) {
         string error = "-ERR Tenant node unavailable\r\n";
@@ -270,31 +1232,13 @@ void handleClient(SOCKET clientSock, const string& clientIp) {
     string success = "+OK Authenticated. Connected to tenant: " + tenantInfo.tenantId + "\r\n";
     send(clientSock, success.c_str(), success.length(), 0);
 
-    thread clientToTenant([clientSock, tenantSock]() {
-        char buf[4096];
-        int n;
-        while ((n = recv(clientSock, buf, sizeof(buf), 0)) > 0) {
-            send(tenantSock, buf, n, 0);
-        }
-        shutdown(tenantSock, SD_SEND);
-    });
-
-    thread tenantToClient([clientSock, tenantSock]() {
-        char buf[4096];
-        int n;
-        while ((n = recv(tenantSock, buf, sizeof(buf), 0)) > 0) {
-            send(clientSock, buf, n, 0);
-        }
-        shutdown(clientSock, SD_SEND);
-    });
-
-    clientToTenant.join();
-    tenantToClient.join();
-
-    closesocket(clientSock);
-    closesocket(tenantSock);
+    if (!pending.empty() && send(tenantSock, pending.data(), (int)pending.size(), 0) == SOCKET_ERROR) {
+        closesocket(tenantSock);
+        closesocket(clientSock);
+        return;
+    }
 
-    cout << "[Router] Client disconnected\n";
+    startProxy(clientSock, tenantSock);
 }
 
 int main() {
@@ -309,6 +1253,9 @@ int main() {
         cerr << "[Router] WSAStartup failed\n";
         return 1;
     }
+#else
+    // A peer that resets mid-write must fail that write, not kill the router
+    signal(SIGPIPE, SIG_IGN);
 #endif
 
     SOCKET listenSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
@@ -347,6 +1294,12 @@ int main() {
         return 1;
     }
 
+    if (!startProxyLoops()) {
+        closesocket(listenSock);
+        return 1;
+    }
+    routePoller().start();
+
     cout << "[Router] Listening on port " << ROUTER_PORT << "\n";
     cout << "[Router] Backend API at " << BACKEND_API_HOST << ":" << BACKEND_API_PORT << "\n";
     cout << "[Router] Press Ctrl+C to stop\n\n";
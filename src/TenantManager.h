@@ -4,6 +4,7 @@
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -64,6 +65,17 @@ public:
         currentMemoryUsage.fetch_add(bytes);
     }
 
+    // Check-and-add in one step so concurrent writers can't overshoot the limit.
+    bool tryAllocate(size_t bytes) {
+        size_t used = currentMemoryUsage.load();
+        while (used + bytes <= memoryLimitBytes) {
+            if (currentMemoryUsage.compare_exchange_weak(used, used + bytes)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
 
     void deallocate(size_t bytes) {
         currentMemoryUsage.fetch_sub(bytes);
@@ -87,7 +99,9 @@ class TenantManager {
 private:
     unordered_map<string, TenantConfig> tenants;
     unordered_map<string, string> apiKeyToTenant;
-    mutable mutex mtx;
+    // Writers (addTenant, loadAPIKeys) take it exclusively; lookups and memory
+    // accounting only read the map and update atomics, so they share it.
+    mutable shared_mutex mtx;
     string apiKeysFile;
 
     // Trim whitespace helper
@@ -111,7 +125,7 @@ public:
     }
 
     bool loadAPIKeys() {
-        lock_guard<mutex> lock(mtx);
+        unique_lock<shared_mutex> lock(mtx);
         apiKeyToTenant.clear();
         
         ifstream f(apiKeysFile);
@@ -155,7 +169,7 @@ public:
         return count > 0;
     }
     void addTenant(const string& id, const string& name, size_t memLimitMB, int port) {
-        lock_guard<mutex> lock(mtx);
+        unique_lock<shared_mutex> lock(mtx);
         
         TenantConfig cfg(id, name, memLimitMB, port);
         tenants[id] = cfg;
@@ -173,7 +187,7 @@ public:
 
 
     string authenticate(const string& apiKey) const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = apiKeyToTenant.find(apiKey);
         if (it != apiKeyToTenant.end()) {
             return it->second;
@@ -183,7 +197,7 @@ public:
 
 
     bool getTenantConfig(const string& tenantId, TenantConfig& cfg) const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
         if (it != tenants.end()) {
             cfg = it->second;
@@ -194,7 +208,7 @@ public:
 
    
     TenantConfig* getTenantConfigPtr(const string& tenantId) {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
         if (it != tenants.end()) {
             return &(it->second);
@@ -204,37 +218,33 @@ public:
 
 
     int getNodePort(const string& tenantId) const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
         return (it != tenants.end()) ? it->second.nodePort : -1;
     }
 
     size_t getMemoryLimit(const string& tenantId) const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
         return (it != tenants.end()) ? it->second.memoryLimitBytes : 0;
     }
 
 
     bool canAllocate(const string& tenantId, size_t bytes) const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
         return (it != tenants.end()) ? it->second.canAllocate(bytes) : false;
     }
 
     bool allocateMemory(const string& tenantId, size_t bytes) {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
-        if (it != tenants.end() && it->second.canAllocate(bytes)) {
-            it->second.allocate(bytes);
-            return true;
-        }
-        return false;
+        return it != tenants.end() && it->second.tryAllocate(bytes);
     }
 
 
     void deallocateMemory(const string& tenantId, size_t bytes) {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
         if (it != tenants.end()) {
             it->second.deallocate(bytes);
@@ -243,7 +253,7 @@ public:
 
 
     string getTenantStats(const string& tenantId) const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         auto it = tenants.find(tenantId);
         if (it == tenants.end()) {
             return "Tenant not found";
@@ -264,7 +274,7 @@ public:
 
 
     string getAllStats() const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         ostringstream oss;
         oss << "=== Tenant Statistics ===\n";
         for (const auto& pair : tenants) {
@@ -282,13 +292,13 @@ public:
 
 
     bool tenantExists(const string& tenantId) const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         return tenants.find(tenantId) != tenants.end();
     }
 
     // Get tenant count
     size_t getTenantCount() const {
-        lock_guard<mutex> lock(mtx);
+        shared_lock<shared_mutex> lock(mtx);
         return tenants.size();
     }
 };
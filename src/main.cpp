@@ -6,6 +6,7 @@
     #include <ws2tcpip.h>
     #pragma comment(lib, "Ws2_32.lib")
     typedef int socklen_t;
+    #define MSG_NOSIGNAL 0
 #else
     #include <sys/types.h>
     #include <sys/socket.h>
@@ -15,11 +16,19 @@
     #include <netdb.h>
     #include <errno.h>
     #include <cstring>
+    #include <netinet/tcp.h>
+    #include <fcntl.h>
     #define SOCKET int
     #define INVALID_SOCKET -1
     #define SOCKET_ERROR -1
     #define closesocket close
     #define WSAGetLastError() errno
+    #define SD_BOTH SHUT_RDWR
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
 #endif
 
 #include <iostream>
@@ -30,12 +39,24 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 #include <vector>
+#include <deque>
+#include <array>
 #include <chrono>
 #include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <functional>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <limits>
 
 #include "TenantManager.h"
+#include "../common/RespParser.h"
+#include "../common/SwissTable.h"
+#include "../common/MpmcQueue.h"
+#include "../common/CommandTable.h"
 
 using namespace std;
 using SteadyClock = chrono::steady_clock;
@@ -46,64 +67,570 @@ string NODE_ADDR = "127.0.0.1";
 string TENANT_ID = "tenant1";
 int WORKER_COUNT = 4;
 int REQUEST_QUEUE_CAPACITY = 1024;
+int REACTOR_COUNT = 2;
+int SHARD_COUNT = 64;
+int REHASH_BUDGET_US = 100;
+bool SHARD_OWNERS = false;
 
 TenantManager tenantMgr;
 
-struct ValueEntry
+// Tenant names interned to small integers, so an entry stores 4 bytes instead
+// of its own copy of the name. A tenant gets its id on its first write; ids are
+// never reused.
+class TenantIds
+{
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    uint32_t find(const string &name) const
+    {
+        shared_lock<shared_mutex> lk(mtx);
+        auto it = ids.find(name);
+        return it == ids.end() ? NONE : it->second;
+    }
+
+    uint32_t intern(const string &name)
+    {
+        unique_lock<shared_mutex> lk(mtx);
+        auto it = ids.emplace(name, (uint32_t)names.size()).first;
+        if (it->second == names.size())
+            names.push_back(name);
+        return it->second;
+    }
+
+    string name(uint32_t id) const
+    {
+        shared_lock<shared_mutex> lk(mtx);
+        return id < names.size() ? names[id] : string();
+    }
+
+private:
+    mutable shared_mutex mtx;
+    unordered_map<string, uint32_t> ids;
+    vector<string> names;
+};
+
+TenantIds tenantIds;
+
+const uint32_t NOT_SCHEDULED = UINT32_MAX;
+const uint8_t ENTRY_HAS_EXPIRY = 1;
+const uint8_t LARGE_CLASS = 0xFF;
+
+// One key. The header, the expiry (only for keys with a TTL), the key bytes and
+// the value bytes share a single allocation from the shard's arena:
+//   [Entry][ExpiryInfo][key][value]
+struct Entry
+{
+    uint32_t keyLen;
+    uint32_t valueLen;
+    uint32_t tenant;    // TenantIds id
+    uint8_t sizeClass;  // arena size class, LARGE_CLASS for a direct allocation
+    uint8_t flags;
+};
+
+struct ExpiryInfo
+{
+    int64_t expiry;     // steady_clock ticks
+    uint32_t heapIndex; // slot in the shard's ExpiryHeap
+};
+
+inline bool hasExpiry(const Entry *e) { return e->flags & ENTRY_HAS_EXPIRY; }
+inline ExpiryInfo *expiryInfo(Entry *e) { return reinterpret_cast<ExpiryInfo *>(e + 1); }
+inline const ExpiryInfo *expiryInfo(const Entry *e) { return reinterpret_cast<const ExpiryInfo *>(e + 1); }
+inline char *keyData(Entry *e) { return reinterpret_cast<char *>(e + 1) + (hasExpiry(e) ? sizeof(ExpiryInfo) : 0); }
+inline const char *keyData(const Entry *e) { return keyData(const_cast<Entry *>(e)); }
+inline string_view entryKey(const Entry *e) { return string_view(keyData(e), e->keyLen); }
+inline string_view entryValue(const Entry *e) { return string_view(keyData(e) + e->keyLen, e->valueLen); }
+
+inline TimePoint entryExpiry(const Entry *e)
+{
+    return hasExpiry(e) ? TimePoint(SteadyClock::duration(expiryInfo(e)->expiry)) : TimePoint{};
+}
+
+inline size_t entrySize(size_t keyLen, size_t valueLen, bool withExpiry)
+{
+    return sizeof(Entry) + (withExpiry ? sizeof(ExpiryInfo) : 0) + keyLen + valueLen;
+}
+
+struct EntryKey
+{
+    string_view operator()(const Entry *e) const { return entryKey(e); }
+};
+
+// Keyspace of one shard: a Swiss table of entry pointers, so a key costs its
+// arena slot plus one 8-byte slot and a control byte.
+using EntryTable = SwissTable<Entry *, EntryKey>;
+
+inline size_t keyHash(string_view key)
+{
+    return EntryTable::hashOf(key);
+}
+
+// Size-classed slab allocator for entries, one per shard and only used under
+// the shard's write lock. Each class carves fixed-size slots out of 64 KiB
+// slabs and recycles freed slots through a free list, so a write costs no
+// malloc once the node is warm. Slabs live as long as the node: memory freed by
+// deletes is reused by later writes, not returned to the OS. Entries larger
+// than MAX_SLAB_ITEM are allocated directly.
+class SlabArena
+{
+public:
+    static const size_t SLAB_BYTES = 64 * 1024;
+    static const size_t MAX_SLAB_ITEM = 4096;
+
+    // Bytes an allocation of size really takes
+    static size_t allocSize(size_t size)
+    {
+        uint8_t cls = classFor(size);
+        return cls == LARGE_CLASS ? size : classSizes()[cls];
+    }
+
+    void *allocate(size_t size, uint8_t &cls)
+    {
+        cls = classFor(size);
+        if (cls == LARGE_CLASS)
+            return ::operator new(size);
+
+        SizeClass &c = classes[cls];
+        if (c.freeList)
+        {
+            FreeSlot *slot = c.freeList;
+            c.freeList = slot->next;
+            return slot;
+        }
+
+        size_t slotSize = classSizes()[cls];
+        if (c.cursor == nullptr || c.cursor + slotSize > c.end)
+        {
+            slabs.emplace_back(new char[SLAB_BYTES]);
+            c.cursor = slabs.back().get();
+            c.end = c.cursor + SLAB_BYTES;
+        }
+        void *p = c.cursor;
+        c.cursor += slotSize;
+        return p;
+    }
+
+    void release(void *p, uint8_t cls)
+    {
+        if (cls == LARGE_CLASS)
+        {
+            ::operator delete(p);
+            return;
+        }
+        FreeSlot *slot = static_cast<FreeSlot *>(p);
+        slot->next = classes[cls].freeList;
+        classes[cls].freeList = slot;
+    }
+
+private:
+    struct FreeSlot
+    {
+        FreeSlot *next;
+    };
+
+    struct SizeClass
+    {
+        FreeSlot *freeList = nullptr;
+        char *cursor = nullptr; // unused tail of the class's newest slab
+        char *end = nullptr;
+    };
+
+    // 8-byte steps up to 128 bytes, then four classes per doubling up to
+    // MAX_SLAB_ITEM, so rounding wastes at most a quarter of a slot.
+    static const vector<size_t> &classSizes()
+    {
+        static const vector<size_t> sizes = []
+        {
+            vector<size_t> v;
+            for (size_t s = 8; s <= 128; s += 8)
+                v.push_back(s);
+            for (size_t base = 128; base < MAX_SLAB_ITEM; base *= 2)
+                for (size_t step = 1; step <= 4; ++step)
+                    v.push_back(base + base / 4 * step);
+            return v;
+        }();
+        return sizes;
+    }
+
+    static uint8_t classFor(size_t size)
+    {
+        if (size <= 128)
+            return (uint8_t)((max<size_t>(size, 1) + 7) / 8 - 1);
+        if (size > MAX_SLAB_ITEM)
+            return LARGE_CLASS;
+        const vector<size_t> &sizes = classSizes();
+        return (uint8_t)(lower_bound(sizes.begin(), sizes.end(), size) - sizes.begin());
+    }
+
+    SizeClass classes[64];
+    vector<unique_ptr<char[]>> slabs;
+};
+
+// Memory charged to the tenant for an entry: its arena slot plus its table slot.
+inline size_t entryBytes(size_t keyLen, size_t valueLen, bool withExpiry)
+{
+    return SlabArena::allocSize(entrySize(keyLen, valueLen, withExpiry)) + EntryTable::SLOT_BYTES;
+}
+
+inline size_t entryBytes(const Entry *e)
+{
+    return entryBytes(e->keyLen, e->valueLen, hasExpiry(e));
+}
+
+// Indexed min-heap of TTL deadlines with at most one item per key. Each entry
+// records its slot in its ExpiryInfo, so changing a TTL fixes the item in place
+// and deleting a key removes it. Only entries with an expiry are ever filed.
+struct ExpiryHeap
+{
+    struct Item
+    {
+        TimePoint expiry;
+        Entry *entry;
+    };
+    vector<Item> items;
+
+    bool empty() const { return items.empty(); }
+    size_t size() const { return items.size(); }
+    const Item &top() const { return items.front(); }
+
+    // Files e's current expiry; e must have one.
+    void schedule(Entry *e)
+    {
+        ExpiryInfo *x = expiryInfo(e);
+        if (x->heapIndex == NOT_SCHEDULED)
+        {
+            items.push_back(Item{entryExpiry(e), e});
+            x->heapIndex = (uint32_t)(items.size() - 1);
+            siftUp(x->heapIndex);
+            return;
+        }
+        items[x->heapIndex].expiry = entryExpiry(e);
+        siftDown(siftUp(x->heapIndex));
+    }
+
+    void remove(Entry *e)
+    {
+        if (!hasExpiry(e))
+            return;
+        ExpiryInfo *x = expiryInfo(e);
+        size_t i = x->heapIndex;
+        if (i == NOT_SCHEDULED)
+            return;
+        x->heapIndex = NOT_SCHEDULED;
+
+        Item last = items.back();
+        items.pop_back();
+        if (i < items.size())
+        {
+            place(i, last);
+            siftDown(siftUp(i));
+        }
+    }
+
+private:
+    void place(size_t i, const Item &it)
+    {
+        items[i] = it;
+        expiryInfo(it.entry)->heapIndex = (uint32_t)i;
+    }
+
+    size_t siftUp(size_t i)
+    {
+        Item it = items[i];
+        while (i > 0)
+        {
+            size_t parent = (i - 1) / 2;
+            if (!(it.expiry < items[parent].expiry))
+                break;
+            place(i, items[parent]);
+            i = parent;
+        }
+        place(i, it);
+        return i;
+    }
+
+    void siftDown(size_t i)
+    {
+        Item it = items[i];
+        size_t n = items.size();
+        while (true)
+        {
+            size_t child = 2 * i + 1;
+            if (child >= n)
+                break;
+            if (child + 1 < n && items[child + 1].expiry < items[child].expiry)
+                child++;
+            if (!(items[child].expiry < it.expiry))
+                break;
+            place(i, items[child]);
+            i = child;
+        }
+        place(i, it);
+    }
+};
+
+// The keyspace is split into SHARD_COUNT (a power of two) shards picked by key
+// hash. Each shard has its own reader/writer lock, so GETs on a shard run in
+// parallel and writes only contend with keys hashing to the same shard. TTLs and
+// entry memory are tracked per shard under the same lock.
+//
+// With --shard-owners, shard i belongs to worker i % WORKER_COUNT instead and
+// only that worker ever touches it, so the locks are skipped altogether.
+//
+// due is when the shard next wants a sweeper pass (its earliest expiry, or now
+// while a resize is migrating), in steady-clock ticks. It is only written under
+// the write lock but read without it, so the sweeper skips idle shards unlocked.
+struct alignas(64) Shard
+{
+    shared_mutex mutex;
+    EntryTable table;
+    ExpiryHeap expiryHeap;
+    SlabArena arena;
+    atomic<int64_t> due{numeric_limits<int64_t>::max()};
+};
+
+unique_ptr<Shard[]> shards;
+size_t shardMask = 0;
+
+// High hash bits pick the shard so the per-shard table still sees well-mixed low bits.
+size_t shardIndex(size_t hash)
+{
+    return (hash >> 40) & shardMask;
+}
+
+Shard &shardFor(size_t hash)
+{
+    return shards[shardIndex(hash)];
+}
+
+// The worker that owns a key's shard in shard-owner mode
+int ownerOf(size_t hash)
+{
+    return (int)(shardIndex(hash) % (size_t)WORKER_COUNT);
+}
+
+unique_lock<shared_mutex> lockShard(Shard &shard)
+{
+    if (SHARD_OWNERS)
+        return unique_lock<shared_mutex>(shard.mutex, defer_lock);
+    return unique_lock<shared_mutex>(shard.mutex);
+}
+
+shared_lock<shared_mutex> lockShardShared(Shard &shard)
+{
+    if (SHARD_OWNERS)
+        return shared_lock<shared_mutex>(shard.mutex, defer_lock);
+    return shared_lock<shared_mutex>(shard.mutex);
+}
+
+// Shard-owner mode: when each worker's shards next have keys to expire or a
+// resize to advance, in steady-clock ticks. The sweeper reads it to decide
+// when to ask a worker for a pass; only the owning worker lowers it.
+unique_ptr<atomic<int64_t>[]> ownerDue;
+
+void lowerOwnerDue(int worker, TimePoint due)
+{
+    atomic<int64_t> &d = ownerDue[worker];
+    if (due.time_since_epoch().count() < d.load())
+        d.store(due.time_since_epoch().count());
+}
+
+// Caller holds the shard's write lock (or owns the shard).
+void lowerShardDue(Shard &shard, TimePoint due)
+{
+    if (due.time_since_epoch().count() < shard.due.load())
+        shard.due.store(due.time_since_epoch().count());
+}
+
+void initShards()
 {
-    string value;
-    TimePoint expiry;
-    size_t bytes;
-    string tenantId;
+    size_t n = 1;
+    while (n < (size_t)max(SHARD_COUNT, 1))
+        n <<= 1;
+    SHARD_COUNT = (int)n;
+    shardMask = n - 1;
+    shards.reset(new Shard[n]);
+    for (size_t i = 0; i < n; ++i)
+        shards[i].table.setRehashBudget(chrono::microseconds(max(REHASH_BUDGET_US, 1)));
+}
+
+// Builds an entry in shard's arena; caller holds the shard's write lock.
+Entry *newEntry(Shard &shard, uint32_t tenant, string_view key, string_view value, TimePoint expiry)
+{
+    bool withExpiry = expiry != TimePoint{};
+    uint8_t cls;
+    Entry *e = static_cast<Entry *>(shard.arena.allocate(entrySize(key.size(), value.size(), withExpiry), cls));
+    e->keyLen = (uint32_t)key.size();
+    e->valueLen = (uint32_t)value.size();
+    e->tenant = tenant;
+    e->sizeClass = cls;
+    e->flags = withExpiry ? ENTRY_HAS_EXPIRY : 0;
+    if (withExpiry)
+    {
+        expiryInfo(e)->expiry = expiry.time_since_epoch().count();
+        expiryInfo(e)->heapIndex = NOT_SCHEDULED;
+    }
+    memcpy(keyData(e), key.data(), key.size());
+    memcpy(keyData(e) + key.size(), value.data(), value.size());
+    return e;
+}
+
+// Returns an unlinked entry's memory to the arena; caller holds the write lock.
+void freeEntry(Shard &shard, Entry *e)
+{
+    shard.expiryHeap.remove(e);
+    shard.arena.release(e, e->sizeClass);
+}
+
+// One client socket. The reactor that owns it appends to readBuf; its worker appends
+// replies to writeBuf and flushes what the socket accepts, the rest goes out on EPOLLOUT.
+// The socket is closed when the last reference (reactor or in-flight request) drops.
+struct ClientRequest;
+struct Connection
+{
+    SOCKET sock;
+    string ip;
+    int worker = 0; // every batch from this socket runs on this worker, in order
+    vector<char> readBuf;
+    size_t readWanted = 0; // parser hint: don't retry until readBuf is this big
+    bool broken = false;   // protocol error seen, input is ignored until close
+    mutex writeMutex;
+    string writeBuf;
+    atomic<bool> closed{false};
+
+    // Shard-owner mode, touched only by this connection's worker: the batch
+    // whose commands are out on their owners, and the ones read after it
+    ClientRequest *inFlight = nullptr;
+    deque<ClientRequest *> backlog;
+
+    Connection(SOCKET s, const string &addr) : sock(s), ip(addr) {}
+    ~Connection() { closesocket(sock); }
+};
+using ConnectionPtr = shared_ptr<Connection>;
+
+// A parsed command. argv views point into the owning request's payload;
+// `error` short-circuits execution with a ready-made reply.
+struct Command
+{
+    string_view tenantId;
+    vector<string_view> argv;
+    string_view error;
 };
 
-unordered_map<string, ValueEntry> store;
-mutex storeMutex;
-const size_t ENTRY_OVERHEAD = 64;
+// Shard-owner mode: a command that touches several workers' shards (INFO, a
+// DEL over keys of different owners) runs on every worker, and each adds its
+// share here. Whoever finishes last writes the reply.
+struct FanOut
+{
+    atomic<int> parts{0};
+    atomic<size_t> count{0};
+    atomic<size_t> bytes{0};
+    atomic<size_t> expires{0};
+};
+
+// Shard-owner mode: where each command of a batch runs and what it answered.
+struct BatchState
+{
+    static constexpr int FANOUT = -1;
 
+    vector<int> owner;           // worker that runs command i, or FANOUT
+    vector<string> replies;
+    unique_ptr<FanOut[]> fanOut; // per command, only when some command fans out
+    atomic<int> outstanding{0};  // workers whose part has not finished yet
+};
+
+// Every command parsed from one read, executed in order with a single reply write.
+// The reactor swaps the connection's read buffer into payload, so the batch is
+// handed to a worker as a bare pointer and nothing is copied on the way.
 struct ClientRequest
 {
-    SOCKET clientSock;
-    string tenantId;
-    string raw;
+    ConnectionPtr conn;
+    vector<char> payload;
+    vector<Command> cmds;
+    bool closeAfter = false;
+    unique_ptr<BatchState> state; // shard-owner mode only
 };
 
-queue<ClientRequest> reqQueue;
-mutex reqMutex;
-condition_variable reqCv;
-atomic<bool> shuttingDown(false);
+// What a worker's inbox carries. Reactors post BATCH; in shard-owner mode the
+// workers also post each other RUN (execute your part of this batch), DONE
+// (every part has run, reply to the client) and SWEEP, from the TTL sweeper.
+struct Task
+{
+    enum Kind : uint8_t
+    {
+        BATCH,
+        RUN,
+        DONE,
+        SWEEP
+    };
+    Kind kind;
+    ClientRequest *batch;
+};
 
-struct ExpiryItem
+// One worker's inbox. It takes REQUEST_QUEUE_CAPACITY / WORKER_COUNT batches
+// (rounded up to a power of two) before submitRequest starts answering busy.
+// In shard-owner mode `admitted` counts batches from accept to reply against
+// that share instead, and the ring has MAIL_SLOTS more for worker-to-worker tasks.
+struct Worker
 {
-    TimePoint expiry;
-    string key;
-    bool operator>(const ExpiryItem &o) const { return expiry > o.expiry; }
+    static constexpr size_t MAIL_SLOTS = 65536;
+
+    unique_ptr<MpmcQueue<Task>> inbox;
+    int capacity = 0;
+    atomic<int> admitted{0};
+    atomic<bool> sweepPosted{false};
 };
-priority_queue<ExpiryItem, vector<ExpiryItem>, greater<ExpiryItem>> expiryHeap;
+
+vector<unique_ptr<Worker>> workerPool;
+atomic<bool> shuttingDown(false);
+
+// Wakes the TTL sweeper early when a SET schedules an expiry before the
+// sweeper's next pass (sweeperWake, in steady-clock ticks); the epoch catches
+// wakeups that land while the sweeper is still scanning shards.
 mutex expiryMutex;
 condition_variable expiryCv;
+uint64_t expiryEpoch = 0;
+atomic<int64_t> sweeperWake(numeric_limits<int64_t>::max());
 
-string trim(const string &s)
+// Later deadlines are picked up by the pass the sweeper already has planned.
+void wakeSweeper(TimePoint due)
 {
-    size_t a = s.find_first_not_of(" \r\n\t");
-    if (a == string::npos)
-        return "";
-    size_t b = s.find_last_not_of(" \r\n\t");
-    return s.substr(a, b - a + 1);
+    if (due.time_since_epoch().count() >= sweeperWake.load())
+        return;
+    {
+        lock_guard<mutex> lk(expiryMutex);
+        expiryEpoch++;
+    }
+    expiryCv.notify_one();
 }
 
-void sendStr(SOCKET s, const string &msg)
+// Writes as much of writeBuf as the socket takes; caller holds writeMutex.
+void flushLocked(Connection &c)
 {
-    const char *buf = msg.c_str();
-    int len = (int)msg.size();
-    int sent = 0;
-    while (sent < len)
+    size_t sent = 0;
+    while (sent < c.writeBuf.size())
     {
-        int r = send(s, buf + sent, len - sent, 0);
-        if (r == SOCKET_ERROR || r == 0)
-            break;
-        sent += r;
+        int r = send(c.sock, c.writeBuf.data() + sent, (int)(c.writeBuf.size() - sent), MSG_NOSIGNAL);
+        if (r > 0)
+        {
+            sent += r;
+            continue;
+        }
+        if (r == SOCKET_ERROR && WSAGetLastError() == EINTR)
+            continue;
+        break; // EAGAIN resumes on EPOLLOUT; hard errors surface on the read side
     }
+    c.writeBuf.erase(0, sent);
+}
+
+void sendStr(Connection &c, const string &msg)
+{
+    if (c.closed.load())
+        return;
+    lock_guard<mutex> lk(c.writeMutex);
+    c.writeBuf += msg;
+    flushLocked(c);
 }
 
 bool parseInt(const string &s, long long &out)
@@ -123,30 +650,50 @@ bool parseInt(const string &s, long long &out)
     }
 }
 
-size_t calcBytes(const string &k, const string &v)
+string bulkReply(string_view v)
 {
-    return k.size() + v.size() + ENTRY_OVERHEAD;
+    string out = "$" + to_string(v.size()) + "\r\n";
+    out.append(v.data(), v.size());
+    out += "\r\n";
+    return out;
 }
 
-string handleSET(const string &tenantId, const string &key, const string &value,
+string handleSET(const string &tenantId, string_view key, string_view value,
                  const string &opt, const string &optVal)
 {
     if (key.empty())
         return "-ERR wrong number of arguments for 'SET'\r\n";
 
-    size_t newBytes = calcBytes(key, value);
-    unique_lock<mutex> lk(storeMutex);
+    TimePoint expiry{};
+    if (opt == "EX" || opt == "PX")
+    {
+        long long n;
+        if (!parseInt(optVal, n) || n <= 0)
+            return opt == "EX" ? "-ERR invalid EX value\r\n" : "-ERR invalid PX value\r\n";
+        if (opt == "EX")
+            expiry = SteadyClock::now() + chrono::seconds(n);
+        else
+            expiry = SteadyClock::now() + chrono::milliseconds(n);
+    }
+
+    bool withExpiry = expiry != TimePoint{};
+    size_t newBytes = entryBytes(key.size(), value.size(), withExpiry);
+    uint32_t tenant = tenantIds.find(tenantId);
+    size_t h = keyHash(key);
+    Shard &shard = shardFor(h);
+    unique_lock<shared_mutex> lk = lockShard(shard);
 
-    auto it = store.find(key);
+    Entry **slot = shard.table.find(key, h);
+    Entry *old = slot ? *slot : nullptr;
     size_t oldBytes = 0;
 
-    if (it != store.end())
+    if (old)
     {
-        if (it->second.tenantId != tenantId)
+        if (old->tenant != tenant)
         {
             return "-ERR key belongs to different tenant\r\n";
         }
-        oldBytes = it->second.bytes;
+        oldBytes = entryBytes(old);
     }
 
     long long delta = (long long)newBytes - (long long)oldBytes;
@@ -163,127 +710,178 @@ string handleSET(const string &tenantId, const string &key, const string &value,
         tenantMgr.deallocateMemory(tenantId, (size_t)(-delta));
     }
 
-    ValueEntry e;
-    e.value = value;
-    e.bytes = newBytes;
-    e.tenantId = tenantId;
-    e.expiry = TimePoint{};
+    // Only tenants the manager accepted get an id
+    if (tenant == TenantIds::NONE)
+        tenant = tenantIds.intern(tenantId);
 
-    if (!opt.empty())
+    bool startedRehash = false;
+    if (old && newBytes == oldBytes && hasExpiry(old) == withExpiry)
     {
-        string OPT = opt;
-        transform(OPT.begin(), OPT.end(), OPT.begin(), ::toupper);
-        if (OPT == "EX")
+        // Same slot and layout: overwrite the value where it is
+        old->valueLen = (uint32_t)value.size();
+        memcpy(keyData(old) + old->keyLen, value.data(), value.size());
+        if (withExpiry)
         {
-            long long sec;
-            if (!parseInt(optVal, sec) || sec <= 0)
-            {
-                if (delta > 0)
-                    tenantMgr.deallocateMemory(tenantId, (size_t)delta);
-                return "-ERR invalid EX value\r\n";
-            }
-            e.expiry = SteadyClock::now() + chrono::seconds(sec);
-        }
-        else if (OPT == "PX")
-        {
-            long long ms;
-            if (!parseInt(optVal, ms) || ms <= 0)
-            {
-                if (delta > 0)
-                    tenantMgr.deallocateMemory(tenantId, (size_t)delta);
-                return "-ERR invalid PX value\r\n";
-            }
-            e.expiry = SteadyClock::now() + chrono::milliseconds(ms);
+            expiryInfo(old)->expiry = expiry.time_since_epoch().count();
+            shard.expiryHeap.schedule(old);
         }
     }
-
-    if (it != store.end())
-    {
-        it->second = move(e);
-    }
     else
     {
-        store.emplace(key, move(e));
+        Entry *e = newEntry(shard, tenant, key, value, expiry);
+        if (old)
+        {
+            *slot = e;
+            freeEntry(shard, old);
+        }
+        else
+        {
+            startedRehash = !shard.table.migrating();
+            shard.table.insert(move(e), h);
+            startedRehash = startedRehash && shard.table.migrating();
+        }
+        if (withExpiry)
+            shard.expiryHeap.schedule(e);
     }
 
-    // Schedule expiry
-    if (store[key].expiry != TimePoint{})
+    // Wake the sweeper for TTLs and for the background steps of a new resize
+    if (withExpiry || startedRehash)
     {
-        ExpiryItem item{store[key].expiry, key};
-        {
-            lock_guard<mutex> lk2(expiryMutex);
-            expiryHeap.push(move(item));
-        }
-        expiryCv.notify_one();
+        TimePoint due = startedRehash ? SteadyClock::now() : expiry;
+        lowerShardDue(shard, due);
+        if (SHARD_OWNERS)
+            lowerOwnerDue(ownerOf(h), due);
+        else
+            lk.unlock();
+        wakeSweeper(due);
     }
 
     return "+OK\r\n";
 }
 
-string handleGET(const string &tenantId, const string &key)
+// Removes an expired entry; caller holds the shard's write lock.
+void eraseExpired(Shard &shard, Entry **slot)
+{
+    Entry *e = *slot;
+    shard.table.erase(slot);
+    size_t bytes = entryBytes(e);
+    uint32_t tenant = e->tenant;
+    freeEntry(shard, e);
+    tenantMgr.deallocateMemory(tenantIds.name(tenant), bytes);
+}
+
+string handleGET(const string &tenantId, string_view key)
 {
     if (key.empty())
         return "-ERR wrong number of arguments for 'GET'\r\n";
 
-    lock_guard<mutex> lk(storeMutex);
-    auto it = store.find(key);
-    if (it == store.end())
+    uint32_t tenant = tenantIds.find(tenantId);
+    if (tenant == TenantIds::NONE)
         return "$-1\r\n";
 
-    if (it->second.tenantId != tenantId)
+    size_t h = keyHash(key);
+    Shard &shard = shardFor(h);
     {
-        return "$-1\r\n";
+        shared_lock<shared_mutex> lk = lockShardShared(shard);
+        Entry **slot = shard.table.find(key, h);
+        if (!slot || (*slot)->tenant != tenant)
+            return "$-1\r\n";
+
+        TimePoint expiry = entryExpiry(*slot);
+        if (expiry == TimePoint{} || SteadyClock::now() < expiry)
+            return bulkReply(entryValue(*slot));
     }
 
-    if (it->second.expiry != TimePoint{} && SteadyClock::now() >= it->second.expiry)
+    // Expired: retake the lock for writing and drop it unless a SET refreshed it meanwhile.
+    unique_lock<shared_mutex> lk = lockShard(shard);
+    Entry **slot = shard.table.find(key, h);
+    if (!slot || (*slot)->tenant != tenant)
+        return "$-1\r\n";
+
+    TimePoint expiry = entryExpiry(*slot);
+    if (expiry != TimePoint{} && SteadyClock::now() >= expiry)
     {
-        size_t bytes = it->second.bytes;
-        string tid = it->second.tenantId;
-        store.erase(it);
-        tenantMgr.deallocateMemory(tid, bytes);
+        eraseExpired(shard, slot);
         return "$-1\r\n";
     }
 
-    const string &v = it->second.value;
-    return "$" + to_string(v.size()) + "\r\n" + v + "\r\n";
+    return bulkReply(entryValue(*slot));
 }
 
-string handleDEL(const string &tenantId, const string &key)
+// Deletes one key of the tenant; returns whether it was there. An expired
+// key the sweeper has not reached yet is dropped but does not count.
+bool deleteKey(uint32_t tenant, const string &tenantId, string_view key)
 {
-    if (key.empty())
-        return "-ERR wrong number of arguments for 'DEL'\r\n";
-
-    lock_guard<mutex> lk(storeMutex);
-    auto it = store.find(key);
-    if (it == store.end())
-        return ":0\r\n";
+    size_t h = keyHash(key);
+    Shard &shard = shardFor(h);
+    unique_lock<shared_mutex> lk = lockShard(shard);
+    Entry **slot = shard.table.find(key, h);
+    if (!slot || (*slot)->tenant != tenant)
+        return false;
 
-    if (it->second.tenantId != tenantId)
+    TimePoint expiry = entryExpiry(*slot);
+    if (expiry != TimePoint{} && SteadyClock::now() >= expiry)
     {
-        return ":0\r\n";
+        eraseExpired(shard, slot);
+        return false;
     }
 
-    size_t bytes = it->second.bytes;
-    store.erase(it);
+    Entry *e = *slot;
+    shard.table.erase(slot);
+    size_t bytes = entryBytes(e);
+    freeEntry(shard, e);
     tenantMgr.deallocateMemory(tenantId, bytes);
-    return ":1\r\n";
+    return true;
 }
 
-string handleINFO(const string &tenantId)
+// DEL key [key ...]; argv[0] is the command name.
+string handleDEL(const string &tenantId, const vector<string_view> &argv)
+{
+    uint32_t tenant = tenantIds.find(tenantId);
+    if (tenant == TenantIds::NONE)
+        return ":0\r\n";
+
+    long long deleted = 0;
+    for (size_t i = 1; i < argv.size(); ++i)
+        deleted += deleteKey(tenant, tenantId, argv[i]) ? 1 : 0;
+    return ":" + to_string(deleted) + "\r\n";
+}
+
+struct KeyStats
 {
     size_t keys = 0;
-    size_t tenantMem = 0;
+    size_t bytes = 0;
+    size_t expires = 0;
+};
+
+// Adds up the tenant's keys in shards first, first + step, ... (all of them
+// with step 1; one worker's in shard-owner mode).
+KeyStats collectKeyStats(const string &tenantId, size_t first, size_t step)
+{
+    KeyStats st;
+    uint32_t tenant = tenantIds.find(tenantId);
+    for (size_t i = first; i < (size_t)SHARD_COUNT; i += step)
     {
-        lock_guard<mutex> lk(storeMutex);
-        for (const auto &pair : store)
+        shared_lock<shared_mutex> lk = lockShardShared(shards[i]);
+        st.expires += shards[i].expiryHeap.size();
+        if (tenant == TenantIds::NONE)
+            continue;
+        shards[i].table.forEach([&](const Entry *e)
         {
-            if (pair.second.tenantId == tenantId)
-            {
-                keys++;
-                tenantMem += pair.second.bytes;
-            }
-        }
+            if (e->tenant != tenant)
+                return;
+            st.keys++;
+            st.bytes += entryBytes(e);
+        });
     }
+    return st;
+}
+
+string infoReply(const string &tenantId, const KeyStats &st)
+{
+    size_t keys = st.keys;
+    size_t tenantMem = st.bytes;
+    size_t expires = st.expires;
 
     TenantConfig cfg;
     string stats;
@@ -297,7 +895,9 @@ string handleINFO(const string &tenantId)
             << "memory_used:" << tenantMem << "\r\n"
             << "memory_limit:" << cfg.memoryLimitBytes << "\r\n"
             << "memory_available:" << cfg.getAvailableMemory() << "\r\n"
-            << "usage_percent:" << fixed << cfg.getUsagePercent() << "\r\n";
+            << "usage_percent:" << fixed << cfg.getUsagePercent() << "\r\n"
+            << "shards:" << SHARD_COUNT << "\r\n"
+            << "expires:" << expires << "\r\n";
         stats = oss.str();
     }
     else
@@ -308,131 +908,728 @@ string handleINFO(const string &tenantId)
     return "$" + to_string(stats.size()) + "\r\n" + stats + "\r\n";
 }
 
-string processCommand(const string &tenantId, const string &raw)
+string handleINFO(const string &tenantId)
 {
-    string line = trim(raw);
-    if (line.empty())
+    return infoReply(tenantId, collectKeyStats(tenantId, 0, 1));
+}
+
+// SET key value [EX seconds | PX milliseconds]
+string handleSETCommand(const string &tenantId, const vector<string_view> &argv)
+{
+    string opt, optVal;
+    if (argv.size() >= 4)
+    {
+        string OPT(argv[3]);
+        transform(OPT.begin(), OPT.end(), OPT.begin(), ::toupper);
+        if (OPT == "EX" || OPT == "PX")
+        {
+            if (argv.size() < 5)
+                return "-ERR invalid syntax\r\n";
+            opt = OPT;
+            optVal = string(argv[4]);
+        }
+    }
+    return handleSET(tenantId, argv[1], argv[2], opt, optVal);
+}
+
+// Handlers by CommandId; commands this node does not implement stay null.
+// processCommand has already checked argv against the command's arity.
+using CommandHandler = string (*)(const string &tenantId, const vector<string_view> &argv);
+
+const array<CommandHandler, CMD_COUNT> commandHandlers = []
+{
+    array<CommandHandler, CMD_COUNT> h{};
+    h[CMD_SET] = handleSETCommand;
+    h[CMD_GET] = [](const string &tenantId, const vector<string_view> &argv)
+    { return handleGET(tenantId, argv[1]); };
+    h[CMD_DEL] = handleDEL;
+    h[CMD_PING] = [](const string &, const vector<string_view> &) -> string
+    { return "+PONG\r\n"; };
+    h[CMD_QUIT] = [](const string &, const vector<string_view> &) -> string
+    { return "+BYE\r\n"; };
+    h[CMD_INFO] = [](const string &tenantId, const vector<string_view> &)
+    { return handleINFO(tenantId); };
+    h[CMD_COMMAND] = [](const string &, const vector<string_view> &argv)
+    { return CommandTable::reply(argv, [](CommandId id)
+                                 { return commandHandlers[id] != nullptr; }); };
+    return h;
+}();
+
+string processCommand(const string &tenantId, const vector<string_view> &argv)
+{
+    if (argv.empty())
         return "";
 
-    istringstream iss(line);
-    string cmd;
-    iss >> cmd;
-    transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+    const CommandSpec *spec = CommandTable::find(argv[0]);
+    if (!spec || !commandHandlers[spec->id])
+        return "-ERR unknown command '" + string(argv[0]) + "'\r\n";
+    if (!spec->arityOk(argv.size()))
+        return CommandTable::arityError(*spec);
+    return commandHandlers[spec->id](tenantId, argv);
+}
+
+// One sweeper pass over a shard: expires due keys, with a bounded number of
+// pops so a burst of expiries never holds the shard for long, and gives a
+// growing table one budgeted rehash step, repeated every REHASH_INTERVAL until
+// its migration is done. Lowers next to when the shard wants the next pass.
+// A shard that is not due yet is skipped without taking its lock.
+void sweepShard(Shard &shard, TimePoint now, TimePoint &next)
+{
+    const int MAX_EXPIRES_PER_SHARD = 256;
+    const auto REHASH_INTERVAL = chrono::milliseconds(1);
 
-    if (cmd == "SET")
+    TimePoint due{TimePoint::duration(shard.due.load())};
+    if (due > now)
     {
-        string key, value;
-        if (!(iss >> key))
-            return "-ERR wrong number of arguments for 'SET'\r\n";
-        if (!(iss >> value))
-            return "-ERR wrong number of arguments for 'SET'\r\n";
+        next = min(next, due);
+        return;
+    }
+
+    unique_lock<shared_mutex> lk = lockShard(shard);
+
+    int budget = MAX_EXPIRES_PER_SHARD;
+    while (!shard.expiryHeap.empty() && shard.expiryHeap.top().expiry <= now && budget-- > 0)
+    {
+        Entry *e = shard.expiryHeap.top().entry;
+        string key(entryKey(e));
+        string tid = tenantIds.name(e->tenant);
+        eraseExpired(shard, shard.table.find(key, keyHash(key)));
+        cout << "[Node] Expired key: " << key << " (tenant: " << tid << ")\n";
+    }
+
+    due = TimePoint::max();
+    if (!shard.expiryHeap.empty())
+        due = shard.expiryHeap.top().expiry;
 
-        string opt, optVal;
-        if (iss >> opt)
+    if (shard.table.migrating() && shard.table.rehashStep())
+        due = min(due, now + REHASH_INTERVAL);
+
+    shard.due.store(due.time_since_epoch().count());
+    next = min(next, due);
+}
+
+bool postSweep(int worker);
+
+// Expires due keys and drives background rehashing. Normally the sweeper walks
+// every shard itself; in shard-owner mode it must not touch them, so it posts
+// a sweep to each worker whose shards are due and sleeps until the next one is.
+void ttlSweeperLoop()
+{
+    while (!shuttingDown.load())
+    {
+        uint64_t epoch;
         {
-            string OPT = opt;
-            transform(OPT.begin(), OPT.end(), OPT.begin(), ::toupper);
-            if (OPT == "EX" || OPT == "PX")
+            lock_guard<mutex> lk(expiryMutex);
+            epoch = expiryEpoch;
+        }
+
+        TimePoint now = SteadyClock::now();
+        TimePoint next = now + chrono::seconds(1);
+
+        // The second pass runs after next is published: a SET that lowered a
+        // due time behind the first pass either sees the new sweeperWake and
+        // notifies, or its due time shows up here. Idle shards cost one load.
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            if (pass == 1)
+                sweeperWake.store(next.time_since_epoch().count());
+
+            if (SHARD_OWNERS)
             {
-                if (!(iss >> optVal))
-                    return "-ERR invalid syntax\r\n";
-                opt = OPT;
+                for (int w = 0; w < WORKER_COUNT; ++w)
+                {
+                    TimePoint due{TimePoint::duration(ownerDue[w].load())};
+                    if (due > now)
+                        next = min(next, due);
+                    else if (!postSweep(w))
+                        next = min(next, now + chrono::milliseconds(1)); // inbox full, retry soon
+                }
             }
             else
             {
-                opt.clear();
+                for (int i = 0; i < SHARD_COUNT; ++i)
+                    sweepShard(shards[i], now, next);
             }
         }
-        return handleSET(tenantId, key, value, opt, optVal);
+
+        unique_lock<mutex> lk(expiryMutex);
+        expiryCv.wait_until(lk, next, [epoch]
+                            { return expiryEpoch != epoch || shuttingDown.load(); });
+    }
+}
+
+// Shard-owner execution. A connection's worker routes each command of a batch
+// to the worker owning its key's shard (RUN), runs its own share on the spot,
+// and replies once every owner is done (DONE). Only the owner ever touches a
+// shard, so the data path takes no locks. A connection has one batch out at a
+// time, and later ones wait in its backlog, so replies keep request order.
+
+void handleTask(int self, const Task &t);
+
+// Posts a task to another worker. Client batches never take the last
+// MAIL_SLOTS of an inbox, so this only waits with that many tasks in flight,
+// and meanwhile the sender works through its own inbox so two workers posting
+// to each other cannot stall.
+void postTask(int self, int target, Task t)
+{
+    MpmcQueue<Task> &dest = *workerPool[target]->inbox;
+    Task own;
+    while (!dest.push(t))
+    {
+        if (workerPool[self]->inbox->tryPop(own))
+            handleTask(self, own);
+        else
+            this_thread::yield();
+    }
+}
+
+// Called by the TTL sweeper; false if the worker's inbox is full.
+bool postSweep(int worker)
+{
+    Worker &w = *workerPool[worker];
+    if (w.sweepPosted.exchange(true))
+        return true;
+    if (w.inbox->push(Task{Task::SWEEP, nullptr}))
+        return true;
+    w.sweepPosted.store(false);
+    return false;
+}
+
+// The worker that runs a command: the owner of its key's shard, every worker
+// for INFO and for a DEL over keys of different owners, and the connection's
+// own worker for anything that touches no key.
+int routeCommand(int home, const Command &c)
+{
+    if (!c.error.empty() || c.argv.empty())
+        return home;
+
+    const CommandSpec *spec = CommandTable::find(c.argv[0]);
+    if (!spec)
+        return home;
+    if (spec->id == CMD_INFO)
+        return BatchState::FANOUT;
+    if (!spec->firstKey || c.argv.size() < 2)
+        return home;
+    if (spec->id == CMD_DEL)
+    {
+        int owner = ownerOf(keyHash(c.argv[1]));
+        for (size_t i = 2; i < c.argv.size(); ++i)
+            if (ownerOf(keyHash(c.argv[i])) != owner)
+                return BatchState::FANOUT;
+        return owner;
     }
-    else if (cmd == "GET")
+    return ownerOf(keyHash(c.argv[1]));
+}
+
+// This worker's share of a fanned-out command; the last share writes the reply.
+void runFanOutPart(int self, const Command &c, FanOut &f, string &reply)
+{
+    string tenantId(c.tenantId);
+    bool del = CommandTable::is(c.argv[0], CMD_DEL);
+    if (del)
+    {
+        uint32_t tenant = tenantIds.find(tenantId);
+        size_t deleted = 0;
+        for (size_t i = 1; tenant != TenantIds::NONE && i < c.argv.size(); ++i)
+            if (ownerOf(keyHash(c.argv[i])) == self && deleteKey(tenant, tenantId, c.argv[i]))
+                deleted++;
+        f.count += deleted;
+    }
+    else
+    {
+        KeyStats st = collectKeyStats(tenantId, (size_t)self, (size_t)WORKER_COUNT);
+        f.count += st.keys;
+        f.bytes += st.bytes;
+        f.expires += st.expires;
+    }
+
+    if (f.parts.fetch_sub(1) != 1)
+        return;
+    if (del)
     {
-        string key;
-        iss >> key;
-        return handleGET(tenantId, key);
+        reply = ":" + to_string(f.count.load()) + "\r\n";
+        return;
     }
-    else if (cmd == "DEL")
+    KeyStats total;
+    total.keys = f.count.load();
+    total.bytes = f.bytes.load();
+    total.expires = f.expires.load();
+    reply = infoReply(tenantId, total);
+}
+
+// Runs this worker's commands of a batch in order; returns whether it was the
+// last part of the batch to finish.
+bool runPart(int self, ClientRequest &req)
+{
+    BatchState &st = *req.state;
+    for (size_t i = 0; i < req.cmds.size(); ++i)
     {
-        string key;
-        iss >> key;
-        return handleDEL(tenantId, key);
+        const Command &c = req.cmds[i];
+        if (st.owner[i] == BatchState::FANOUT)
+            runFanOutPart(self, c, st.fanOut[i], st.replies[i]);
+        else if (st.owner[i] == self)
+            st.replies[i] = c.error.empty() ? processCommand(string(c.tenantId), c.argv) : string(c.error);
     }
-    else if (cmd == "QUIT")
+    return st.outstanding.fetch_sub(1) == 1;
+}
+
+// Sends a batch's commands to their owners and runs this worker's share.
+// Returns whether the batch is already complete.
+bool startBatch(int self, ClientRequest *req)
+{
+    size_t n = req->cmds.size();
+    req->state = make_unique<BatchState>();
+    BatchState &st = *req->state;
+    st.owner.resize(n);
+    st.replies.resize(n);
+
+    vector<char> involved(WORKER_COUNT, 0);
+    bool fansOut = false;
+    for (size_t i = 0; i < n; ++i)
     {
-        return "+BYE\r\n";
+        st.owner[i] = routeCommand(self, req->cmds[i]);
+        if (st.owner[i] == BatchState::FANOUT)
+            fansOut = true;
+        else
+            involved[st.owner[i]] = 1;
     }
-    else if (cmd == "INFO")
+    if (fansOut)
     {
-        return handleINFO(tenantId);
+        st.fanOut.reset(new FanOut[n]);
+        for (size_t i = 0; i < n; ++i)
+            if (st.owner[i] == BatchState::FANOUT)
+                st.fanOut[i].parts.store(WORKER_COUNT);
+        fill(involved.begin(), involved.end(), 1);
+    }
+    st.outstanding.store((int)count(involved.begin(), involved.end(), 1));
+
+    req->conn->inFlight = req;
+    for (int w = 0; w < WORKER_COUNT; ++w)
+        if (involved[w] && w != self)
+            postTask(self, w, Task{Task::RUN, req});
+    return involved[self] && runPart(self, *req);
+}
+
+// Writes a completed batch's replies; returns the connection's next batch, if any.
+ClientRequest *finishBatch(int self, ClientRequest *done)
+{
+    unique_ptr<ClientRequest> req(done);
+    string out;
+    for (const string &r : req->state->replies)
+        out += r;
+    if (!out.empty())
+        sendStr(*req->conn, out);
+    if (req->closeAfter)
+        shutdown(req->conn->sock, SD_BOTH);
+    workerPool[self]->admitted.fetch_sub(1);
+
+    Connection &c = *req->conn;
+    c.inFlight = nullptr;
+    if (c.backlog.empty())
+        return nullptr;
+    ClientRequest *next = c.backlog.front();
+    c.backlog.pop_front();
+    return next;
+}
+
+// Runs a connection's batches until one has to wait on other workers.
+void runBatches(int self, ClientRequest *req)
+{
+    while (req && startBatch(self, req))
+        req = finishBatch(self, req);
+}
+
+// SWEEP: one sweeper pass over this worker's shards, then tell the sweeper
+// when the next one is due.
+void sweepOwned(int self)
+{
+    workerPool[self]->sweepPosted.store(false);
+    TimePoint now = SteadyClock::now();
+    TimePoint next = now + chrono::seconds(1);
+    for (size_t i = (size_t)self; i < (size_t)SHARD_COUNT; i += (size_t)WORKER_COUNT)
+        sweepShard(shards[i], now, next);
+    ownerDue[self].store(next.time_since_epoch().count());
+    wakeSweeper(next);
+}
+
+void handleTask(int self, const Task &t)
+{
+    switch (t.kind)
+    {
+    case Task::BATCH:
+        if (t.batch->conn->inFlight)
+            t.batch->conn->backlog.push_back(t.batch);
+        else
+            runBatches(self, t.batch);
+        break;
+    case Task::RUN:
+        if (runPart(self, *t.batch))
+            postTask(self, t.batch->conn->worker, Task{Task::DONE, t.batch});
+        break;
+    case Task::DONE:
+        runBatches(self, finishBatch(self, t.batch));
+        break;
+    case Task::SWEEP:
+        sweepOwned(self);
+        break;
+    }
+}
+
+void ownerLoop(int self)
+{
+    MpmcQueue<Task> &inbox = *workerPool[self]->inbox;
+    MpmcQueue<Task>::Consumer spin;
+    Task t;
+    while (inbox.pop(t, spin, shuttingDown))
+        handleTask(self, t);
+}
+
+// Runs the batches of the connections assigned to worker `id`. A connection's
+// batches all go through this one queue, so its replies leave in request order.
+// Batches already waiting are taken together and every connection among them
+// gets a single write for all of its replies.
+void workerLoop(int id)
+{
+    if (SHARD_OWNERS)
+        return ownerLoop(id);
+
+    const size_t MAX_BATCHES_PER_PASS = 32;
+    MpmcQueue<Task> &queue = *workerPool[id]->inbox;
+    MpmcQueue<Task>::Consumer self;
+    vector<unique_ptr<ClientRequest>> batches;
+    vector<pair<Connection *, string>> replies;
+    Task next;
+
+    while (queue.pop(next, self, shuttingDown))
+    {
+        batches.emplace_back(next.batch);
+        while (batches.size() < MAX_BATCHES_PER_PASS && queue.tryPop(next))
+            batches.emplace_back(next.batch);
+
+        for (const auto &req : batches)
+        {
+            auto it = find_if(replies.begin(), replies.end(), [&](const pair<Connection *, string> &r)
+                              { return r.first == req->conn.get(); });
+            string &out = it != replies.end() ? it->second : replies.emplace_back(req->conn.get(), string()).second;
+            for (const Command &c : req->cmds)
+            {
+                if (!c.error.empty())
+                    out.append(c.error);
+                else
+                    out += processCommand(string(c.tenantId), c.argv);
+            }
+        }
+
+        for (const auto &r : replies)
+            if (!r.second.empty())
+                sendStr(*r.first, r.second);
+        for (const auto &req : batches)
+            if (req->closeAfter)
+                shutdown(req->conn->sock, SD_BOTH);
+        replies.clear();
+        batches.clear();
+    }
+}
+
+// Queues a parsed batch for its connection's worker, or answers every command in it with
+// a busy error when the queue is full so pipelined clients still get one reply each.
+void submitRequest(unique_ptr<ClientRequest> req)
+{
+    Worker &w = *workerPool[req->conn->worker];
+    bool queued;
+    if (SHARD_OWNERS)
+    {
+        queued = w.admitted.fetch_add(1) < w.capacity && w.inbox->push(Task{Task::BATCH, req.get()});
+        if (!queued)
+            w.admitted.fetch_sub(1);
     }
     else
     {
-        return "-ERR unknown command '" + cmd + "'\r\n";
+        queued = w.inbox->push(Task{Task::BATCH, req.get()});
+    }
+
+    if (queued)
+    {
+        req.release();
+        return;
     }
+
+    string busy;
+    for (size_t i = 0; i < req->cmds.size(); ++i)
+        busy += "-ERR server busy\r\n";
+    sendStr(*req->conn, busy);
 }
 
-void workerLoop()
+// Parses every complete request in readBuf into one batch. Multibulk requests
+// run as the node's tenant; inline lines keep the "tenantId COMMAND args..." form.
+// Arguments stay views into the buffer, which moves into the batch as a whole
+// when fully consumed and is copied only when a partial frame is left behind.
+void dispatchRequests(const ConnectionPtr &conn)
 {
-    while (!shuttingDown.load())
+    vector<char> &in = conn->readBuf;
+    if (conn->broken || in.size() < conn->readWanted)
+        return;
+    conn->readWanted = 0;
+
+    ClientRequest req;
+    req.conn = conn;
+    size_t pos = 0;
+    vector<string_view> argv;
+
+    while (pos < in.size())
     {
-        ClientRequest req;
+        size_t consumed = 0, needed = 0;
+        const char *error = nullptr;
+        const char *frame = in.data() + pos;
+        RespParser::Status st = RespParser::parse(frame, in.size() - pos, consumed, argv, needed, error);
+
+        if (st == RespParser::Incomplete)
         {
-            unique_lock<mutex> lk(reqMutex);
-            reqCv.wait(lk, []
-                       { return !reqQueue.empty() || shuttingDown.load(); });
-            if (shuttingDown.load() && reqQueue.empty())
-                return;
-            req = move(reqQueue.front());
-            reqQueue.pop();
+            conn->readWanted = needed;
+            break;
+        }
+        if (st == RespParser::Error)
+        {
+            req.cmds.push_back(Command{{}, {}, error});
+            req.closeAfter = true;
+            conn->broken = true;
+            pos = in.size();
+            break;
+        }
+
+        pos += consumed;
+        if (argv.empty())
+            continue;
+
+        Command c;
+        if (RespParser::isMultibulk(frame))
+        {
+            c.tenantId = TENANT_ID;
+            c.argv = move(argv);
         }
+        else if (argv.size() < 2)
+        {
+            c.error = "-ERR invalid command format\r\n";
+        }
+        else
+        {
+            c.tenantId = argv[0];
+            c.argv.assign(argv.begin() + 1, argv.end());
+        }
+        req.cmds.push_back(move(c));
+    }
 
-        string resp = processCommand(req.tenantId, req.raw);
-        if (!resp.empty())
-            sendStr(req.clientSock, resp);
+    if (pos == in.size())
+    {
+        req.payload.swap(in);
+    }
+    else if (pos > 0)
+    {
+        req.payload.assign(in.begin(), in.begin() + pos);
+        const char *oldBase = in.data();
+        const char *newBase = req.payload.data();
+        auto rebase = [&](string_view &v)
+        {
+            if (v.data() >= oldBase && v.data() < oldBase + pos)
+                v = string_view(newBase + (v.data() - oldBase), v.size());
+        };
+        for (Command &c : req.cmds)
+        {
+            rebase(c.tenantId);
+            for (string_view &a : c.argv)
+                rebase(a);
+        }
+        in.erase(in.begin(), in.begin() + pos);
     }
+
+    if (!req.cmds.empty())
+        submitRequest(make_unique<ClientRequest>(move(req)));
 }
 
-void ttlSweeperLoop()
+#ifdef __linux__
+// Edge-triggered epoll reactor. Each reactor owns its connections; the accept
+// thread hands new sockets over through `incoming` and wakes it via eventfd.
+struct Reactor
 {
-    while (!shuttingDown.load())
+    int epollFd = -1;
+    int wakeFd = -1;
+    mutex incomingMutex;
+    vector<ConnectionPtr> incoming;
+    unordered_map<SOCKET, ConnectionPtr> conns;
+};
+
+vector<unique_ptr<Reactor>> reactors;
+
+void closeConnection(Reactor &r, const ConnectionPtr &conn)
+{
+    conn->closed.store(true);
+    epoll_ctl(r.epollFd, EPOLL_CTL_DEL, conn->sock, nullptr);
+    cout << "[Node] Client disconnected: " << conn->ip << "\n";
+    r.conns.erase(conn->sock);
+}
+
+// Drains the socket until EAGAIN (required with EPOLLET); false on EOF or error.
+bool readAvailable(const ConnectionPtr &conn)
+{
+    char buf[16384];
+    bool open = true;
+
+    while (true)
     {
-        unique_lock<mutex> lk(expiryMutex);
-        if (expiryHeap.empty())
+        ssize_t n = recv(conn->sock, buf, sizeof(buf), 0);
+        if (n > 0)
         {
-            expiryCv.wait_for(lk, chrono::seconds(1));
+            conn->readBuf.insert(conn->readBuf.end(), buf, buf + n);
             continue;
         }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        open = false;
+        break;
+    }
 
-        ExpiryItem top = expiryHeap.top();
-        TimePoint now = SteadyClock::now();
+    dispatchRequests(conn);
+    return open;
+}
 
-        if (now < top.expiry)
+void adoptIncoming(Reactor &r)
+{
+    uint64_t v;
+    while (read(r.wakeFd, &v, sizeof(v)) > 0)
+    {
+    }
+
+    vector<ConnectionPtr> fresh;
+    {
+        lock_guard<mutex> lk(r.incomingMutex);
+        fresh.swap(r.incoming);
+    }
+
+    for (auto &conn : fresh)
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = conn->sock;
+        if (epoll_ctl(r.epollFd, EPOLL_CTL_ADD, conn->sock, &ev) < 0)
         {
-            expiryCv.wait_until(lk, top.expiry);
+            cerr << "[Reactor] epoll_ctl failed: " << errno << "\n";
+            conn->closed.store(true);
             continue;
         }
+        r.conns.emplace(conn->sock, conn);
+    }
+}
 
-        expiryHeap.pop();
-        lk.unlock();
+void reactorLoop(Reactor &r)
+{
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
 
-        lock_guard<mutex> lk2(storeMutex);
-        auto it = store.find(top.key);
-        if (it != store.end())
+    while (!shuttingDown.load())
+    {
+        int n = epoll_wait(r.epollFd, events, MAX_EVENTS, 1000);
+        if (n < 0)
         {
-            if (it->second.expiry != TimePoint{} && SteadyClock::now() >= it->second.expiry)
+            if (errno == EINTR)
+                continue;
+            cerr << "[Reactor] epoll_wait failed: " << errno << "\n";
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (events[i].data.fd == r.wakeFd)
+            {
+                adoptIncoming(r);
+                continue;
+            }
+
+            auto it = r.conns.find(events[i].data.fd);
+            if (it == r.conns.end())
+                continue;
+            ConnectionPtr conn = it->second;
+            uint32_t ev = events[i].events;
+
+            if (ev & EPOLLOUT)
             {
-                size_t bytes = it->second.bytes;
-                string tid = it->second.tenantId;
-                store.erase(it);
-                tenantMgr.deallocateMemory(tid, bytes);
-                cout << "[Node] Expired key: " << top.key << " (tenant: " << tid << ")\n";
+                lock_guard<mutex> lk(conn->writeMutex);
+                flushLocked(*conn);
+            }
+
+            if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))
+            {
+                if (!readAvailable(conn))
+                    closeConnection(r, conn);
             }
         }
     }
 }
 
+bool startReactors()
+{
+    for (int i = 0; i < REACTOR_COUNT; ++i)
+    {
+        auto r = make_unique<Reactor>();
+        r->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        r->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (r->epollFd < 0 || r->wakeFd < 0)
+        {
+            cerr << "[Reactor] setup failed: " << errno << "\n";
+            return false;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = r->wakeFd;
+        epoll_ctl(r->epollFd, EPOLL_CTL_ADD, r->wakeFd, &ev);
+
+        reactors.push_back(move(r));
+    }
+
+    for (auto &r : reactors)
+        thread(reactorLoop, ref(*r)).detach();
+    return true;
+}
+
+void handOff(const ConnectionPtr &conn)
+{
+    static atomic<size_t> nextReactor(0);
+    Reactor &r = *reactors[nextReactor.fetch_add(1) % reactors.size()];
+
+    {
+        lock_guard<mutex> lk(r.incomingMutex);
+        r.incoming.push_back(conn);
+    }
+    uint64_t one = 1;
+    if (write(r.wakeFd, &one, sizeof(one)) < 0)
+        cerr << "[Reactor] wakeup failed: " << errno << "\n";
+}
+#else
+// Fallback for platforms without epoll: one blocking reader thread per client.
+void handOff(const ConnectionPtr &conn)
+{
+    thread([conn]()
+           {
+        char buf[4096];
+        while (true) {
+            int bytes = recv(conn->sock, buf, (int)sizeof(buf), 0);
+            if (bytes <= 0) {
+                conn->closed.store(true);
+                cout << "[Node] Client disconnected: " << conn->ip << "\n";
+                break;
+            }
+            conn->readBuf.insert(conn->readBuf.end(), buf, buf + bytes);
+            dispatchRequests(conn);
+        } })
+        .detach();
+}
+#endif
+
 void acceptLoop(SOCKET listenSock)
 {
+    size_t nextWorker = 0;
     while (!shuttingDown.load())
     {
         sockaddr_in clientAddr{};
@@ -453,62 +1650,15 @@ void acceptLoop(SOCKET listenSock)
         inet_ntop(AF_INET, &clientAddr.sin_addr, ip, INET_ADDRSTRLEN);
         cout << "[Node] Client connected: " << ip << "\n";
 
-        thread([clientSock, ip]()
-               {
-            char buf[4096];
-            while (true) {
-                int bytes = recv(clientSock, buf, (int)sizeof(buf) - 1, 0);
-                if (bytes <= 0) {
-                    cout << "[Node] Client disconnected: " << ip << "\n";
-                    closesocket(clientSock);
-                    break;
-                }
-                
-                buf[bytes] = '\0';
-                string in(buf);
-                size_t pos = 0;
-                
-                while (pos < in.size()) {
-                    size_t nl = in.find_first_of("\r\n", pos);
-                    string line;
-                    
-                    if (nl == string::npos) {
-                        line = in.substr(pos);
-                        pos = in.size();
-                    } else {
-                        line = in.substr(pos, nl - pos);
-                        size_t j = nl;
-                        while (j < in.size() && (in[j] == '\r' || in[j] == '\n')) ++j;
-                        pos = j;
-                    }
-                    
-                    line = trim(line);
-                    if (line.empty()) continue;
-                    
-                    // Parse tenant ID from command (format: "tenantId COMMAND args...")
-                    istringstream iss(line);
-                    string tenantId, restOfCommand;
-                    iss >> tenantId;
-                    getline(iss, restOfCommand);
-                    restOfCommand = trim(restOfCommand);
-                    
-                    if (restOfCommand.empty()) {
-                        sendStr(clientSock, "-ERR invalid command format\r\n");
-                        continue;
-                    }
-                    
-                    {
-                        unique_lock<mutex> lk(reqMutex);
-                        if ((int)reqQueue.size() >= REQUEST_QUEUE_CAPACITY) {
-                            sendStr(clientSock, "-ERR server busy\r\n");
-                            continue;
-                        }
-                        reqQueue.push(ClientRequest{clientSock, tenantId, restOfCommand});
-                    }
-                    reqCv.notify_one();
-                }
-            } })
-            .detach();
+        int one = 1;
+        setsockopt(clientSock, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+#ifdef __linux__
+        fcntl(clientSock, F_SETFL, fcntl(clientSock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+        auto conn = make_shared<Connection>(clientSock, ip);
+        conn->worker = (int)(nextWorker++ % (size_t)WORKER_COUNT);
+        handOff(conn);
     }
 }
 
@@ -521,19 +1671,36 @@ int main(int argc, char *argv[])
             NODE_PORT = stoi(argv[++i]);
         else if (a == "--workers" && i + 1 < argc)
             WORKER_COUNT = stoi(argv[++i]);
+        else if (a == "--shards" && i + 1 < argc)
+            SHARD_COUNT = stoi(argv[++i]);
+        else if (a == "--reactors" && i + 1 < argc)
+            REACTOR_COUNT = stoi(argv[++i]);
         else if (a == "--queue" && i + 1 < argc)
             REQUEST_QUEUE_CAPACITY = stoi(argv[++i]);
         else if (a == "--addr" && i + 1 < argc)
             NODE_ADDR = argv[++i];
         else if (a == "--tenant" && i + 1 < argc)
             TENANT_ID = argv[++i];
+        else if (a == "--rehash-budget-us" && i + 1 < argc)
+            REHASH_BUDGET_US = stoi(argv[++i]);
+        else if (a == "--shard-owners")
+            SHARD_OWNERS = true;
     }
 
+    // Every worker owns at least one shard
+    if (SHARD_OWNERS)
+        SHARD_COUNT = max(SHARD_COUNT, WORKER_COUNT);
+    initShards();
+
     cout << "=================================\n";
     cout << "  MiniRedis Storage Node v2.0\n";
     cout << "=================================\n";
     cout << "[Node] Port: " << NODE_PORT << "\n";
     cout << "[Node] Workers: " << WORKER_COUNT << "\n";
+    cout << "[Node] Shards: " << SHARD_COUNT << (SHARD_OWNERS ? " (owned by workers)" : "") << "\n";
+#ifdef __linux__
+    cout << "[Node] Reactors: " << REACTOR_COUNT << "\n";
+#endif
     cout << "[Node] Serving tenant: " << TENANT_ID << "\n\n";
 
     tenantMgr.addTenant(TENANT_ID, "Node Tenant", NODE_PORT);
@@ -587,9 +1754,34 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (WORKER_COUNT < 1)
+    {
+        cerr << "[Node] need at least one worker\n";
+        closesocket(listenSock);
+        return 1;
+    }
+    size_t perWorker = (max(REQUEST_QUEUE_CAPACITY, 1) + WORKER_COUNT - 1) / WORKER_COUNT;
+    ownerDue.reset(new atomic<int64_t>[WORKER_COUNT]);
+    for (int i = 0; i < WORKER_COUNT; ++i)
+    {
+        auto w = make_unique<Worker>();
+        w->capacity = (int)perWorker;
+        w->inbox = make_unique<MpmcQueue<Task>>(perWorker + (SHARD_OWNERS ? Worker::MAIL_SLOTS : 0));
+        workerPool.push_back(move(w));
+        ownerDue[i].store(0);
+    }
     vector<thread> workers;
     for (int i = 0; i < WORKER_COUNT; ++i)
-        workers.emplace_back(workerLoop);
+        workers.emplace_back(workerLoop, i);
+
+#ifdef __linux__
+    if (REACTOR_COUNT < 1 || !startReactors())
+    {
+        cerr << "[Node] could not start reactors\n";
+        closesocket(listenSock);
+        return 1;
+    }
+#endif
 
     thread(ttlSweeperLoop).detach();
     thread(acceptLoop, listenSock).detach();
@@ -599,7 +1791,8 @@ int main(int argc, char *argv[])
         this_thread::sleep_for(chrono::seconds(60));
 
     shuttingDown.store(true);
-    reqCv.notify_all();
+    for (auto &w : workerPool)
+        w->inbox->wakeAll();
     expiryCv.notify_all();
     for (auto &t : workers)
         if (t.joinable())